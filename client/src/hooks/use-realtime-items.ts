@@ -2,10 +2,20 @@ import { useEffect, useRef } from 'react';
 import { useQueryClient } from '@tanstack/react-query';
 import { type Item } from '@/lib/api';
 
+function applyItemsDelta(items: Item[] | undefined, changed: Item[], removed: string[]) {
+  if (!items) return items;
+  const dropped = new Set([...removed, ...changed.map((item) => item.id)]);
+  const next = items.filter((item) => !dropped.has(item.id)).concat(changed);
+  next.sort((a, b) => new Date(b.createdAt).getTime() - new Date(a.createdAt).getTime());
+  return next;
+}
+
 export function useRealtimeItems() {
   const queryClient = useQueryClient();
   const wsRef = useRef<WebSocket | null>(null);
   const reconnectTimeoutRef = useRef<ReturnType<typeof setTimeout> | null>(null);
+  // Version of the last items_delta applied; null until a snapshot arrives
+  const versionRef = useRef<number | null>(null);
 
   useEffect(() => {
     const connect = () => {
@@ -15,15 +25,36 @@ export function useRealtimeItems() {
       const ws = new WebSocket(wsUrl);
       wsRef.current = ws;
 
+      const requestSnapshot = () => {
+        versionRef.current = null;
+        if (ws.readyState === WebSocket.OPEN) {
+          ws.send(JSON.stringify({ type: 'items_snapshot_request' }));
+        }
+      };
+
       ws.onopen = () => {
         console.log('WebSocket connected');
+        requestSnapshot();
       };
 
       ws.onmessage = (event) => {
         try {
           const message = JSON.parse(event.data);
-          if (message.type === 'items_update') {
-            queryClient.setQueryData(['items'], message.data as Item[]);
+          if (message.type === 'items_snapshot') {
+            versionRef.current = message.data.version;
+            queryClient.setQueryData(['items'], message.data.items as Item[]);
+          } else if (message.type === 'items_delta') {
+            const { version, changed, removed } = message.data as { version: number; changed: Item[]; removed: string[] };
+            if (versionRef.current === null) {
+              // Snapshot already requested; it will include this change
+              return;
+            }
+            if (version !== versionRef.current + 1) {
+              requestSnapshot();
+              return;
+            }
+            versionRef.current = version;
+            queryClient.setQueryData<Item[]>(['items'], (items) => applyItemsDelta(items, changed, removed));
           }
         } catch (error) {
           console.error('Failed to parse WebSocket message:', error);
@@ -71,12 +71,12 @@ export default function Transactions() {
 
   useWebSocket({
     onMessage: (message: { type: string; data: unknown }) => {
-      if (message.type === 'transaction_added') {
-        const newTransaction = message.data as Transaction;
+      if (message.type === 'transactions_added') {
+        const newTransactions = message.data as Transaction[];
         setRealtimeTransactions((prev) => {
-          const exists = prev.some((t) => t.id === newTransaction.id);
-          if (exists) return prev;
-          return [newTransaction, ...prev];
+          const fresh = newTransactions.filter((t) => !prev.some((existing) => existing.id === t.id));
+          if (fresh.length === 0) return prev;
+          return [...fresh.reverse(), ...prev];
         });
       }
     },
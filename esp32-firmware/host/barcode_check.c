@@ -0,0 +1,92 @@
+/*
+ * Checks configuration barcodes against the real keycode map: each one is
+ * typed as the scanner would send it (one HID keycode per character, then
+ * Enter), decoded through hid_keymap.c, and handed to wifi_power.c, which
+ * must take it and select a policy. Every policy has to be reachable.
+ *
+ *   barcode_check BARCODE...
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "hid_keymap.h"
+#include "wifi_power.h"
+
+#define MAX_BARCODE 64
+
+// Reverse of hid_keycode_to_ascii; 0 if no key produces c
+static unsigned char key_for(char c)
+{
+    for (int k = 1; k < 256; k++) {
+        if (hid_keycode_to_ascii((unsigned char)k) == c) {
+            return (unsigned char)k;
+        }
+    }
+    return 0;
+}
+
+// Simulates the scanner: what arrives at the API task for this label
+static bool scan(const char *label, char *out, size_t out_len)
+{
+    size_t len = 0;
+    for (const char *p = label; ; p++) {
+        unsigned char key = key_for(*p == '\0' ? '\n' : *p);
+        if (key == 0) {
+            fprintf(stderr, "%s: '%c' has no keycode\n", label, *p);
+            return false;
+        }
+        char c = hid_keycode_to_ascii(key);
+        if (c == '\n') {
+            break;
+        }
+        if (len + 1 < out_len) {
+            out[len++] = c;
+        }
+    }
+    out[len] = '\0';
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s BARCODE...\n", argv[0]);
+        return 2;
+    }
+    if (wifi_power_init() != ESP_OK) {
+        fprintf(stderr, "wifi_power_init failed\n");
+        return 1;
+    }
+
+    bool reached[WIFI_POWER_POLICY_COUNT] = { false };
+    int failures = 0;
+
+    for (int i = 1; i < argc; i++) {
+        char decoded[MAX_BARCODE];
+        bool accepted = false;
+        if (!scan(argv[i], decoded, sizeof(decoded))) {
+            failures++;
+        } else if (!wifi_power_handle_barcode(decoded, &accepted) || !accepted) {
+            fprintf(stderr, "%s: decoded as '%s', not taken as a setting\n", argv[i], decoded);
+            failures++;
+        } else {
+            reached[wifi_power_get_policy()] = true;
+        }
+    }
+
+    for (int p = 0; p < WIFI_POWER_POLICY_COUNT; p++) {
+        if (!reached[p]) {
+            fprintf(stderr, "no barcode selects policy '%s'\n",
+                    wifi_power_policy_name((wifi_power_policy_t)p));
+            failures++;
+        }
+    }
+
+    if (failures > 0) {
+        return 1;
+    }
+    printf("%d configuration barcodes decode and apply\n", argc - 1);
+    return 0;
+}
@@ -0,0 +1,269 @@
+/*
+ * Host harness for the display code: renders every screen through
+ * display_render.c and panel.c into the emulated SSD1306, then either
+ * writes the panel contents as PBM images, compares them against the
+ * golden set, or times each screen.
+ *
+ *   render_harness golden OUT_DIR
+ *   render_harness check GOLDEN_DIR OUT_DIR
+ *   render_harness bench [ITERATIONS]
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "panel.h"
+#include "display_render.h"
+#include "ssd1306_sim.h"
+
+typedef struct {
+    const char *name;
+    screen_desc_t desc;
+    int marquee_steps;      // Frames of scrolling before the capture
+} fixture_t;
+
+#define LONG_NAME "Heavy Duty Stainless Steel Shelf Bracket"
+#define LONG_BARCODE "ITEM-2025-000000123456789-EXTRA"
+
+static const fixture_t fixtures[] = {
+    { "startup", { .screen = SCREEN_STARTUP } },
+    { "scanning", { .screen = SCREEN_SCANNING, .text = "ITEM-2025-12345" } },
+    { "scanning_long", { .screen = SCREEN_SCANNING, .text = LONG_BARCODE }, 30 },
+    { "not_found", { .screen = SCREEN_NOT_FOUND, .text = "UNKNOWN-123" } },
+    { "out_of_stock", { .screen = SCREEN_OUT_OF_STOCK, .name = "USB-C Cable 2m",
+                        .category = "Electronics", .stock_health = "out_of_stock" } },
+    { "success", { .screen = SCREEN_SUCCESS, .name = "USB-C Cable 2m",
+                   .category = "Electronics", .stock = 41 } },
+    { "added", { .screen = SCREEN_ADDED, .name = "Packing Tape {clear}",
+                 .category = "Supplies", .stock_health = "healthy", .quantity = 12, .stock = 60 } },
+    { "deducted", { .screen = SCREEN_DEDUCTED, .name = "Safety Gloves L",
+                    .category = "PPE", .stock_health = "low", .quantity = 3, .stock = 4 } },
+    { "view_details", { .screen = SCREEN_VIEW_DETAILS, .name = "Cordless Drill",
+                        .category = "Tools", .stock_health = "healthy", .quantity = 7, .stock = 10 } },
+    { "partial_deduction", { .screen = SCREEN_PARTIAL_DEDUCTION, .name = LONG_NAME,
+                             .category = "Hardware | Shelving", .stock_health = "out_of_stock",
+                             .quantity = 2, .requested = 5, .stock = 0 } },
+    { "partial_deduction_scrolled", { .screen = SCREEN_PARTIAL_DEDUCTION, .name = LONG_NAME,
+                                      .category = "Hardware | Shelving", .stock_health = "out_of_stock",
+                                      .quantity = 2, .requested = 5, .stock = 0 }, 45 },
+    { "error", { .screen = SCREEN_ERROR, .text = "Server error 503" } },
+    { "wifi_connecting", { .screen = SCREEN_WIFI_CONNECTING } },
+    { "wifi_connected", { .screen = SCREEN_WIFI_CONNECTED } },
+    { "cached_item", { .screen = SCREEN_CACHED_ITEM, .name = "Cordless Drill",
+                       .category = "Tools", .stock_health = "healthy", .stock = 6 } },
+    { "offline_details", { .screen = SCREEN_OFFLINE_DETAILS, .name = "Safety Gloves L",
+                           .category = "PPE", .stock_health = "low", .quantity = 4, .stock = 20 } },
+};
+
+#define FIXTURE_COUNT (sizeof(fixtures) / sizeof(fixtures[0]))
+
+static void show(const fixture_t *f)
+{
+    oled_begin_frame();
+    render_screen(&f->desc);
+    oled_update();
+    for (int i = 0; i < f->marquee_steps && marquee_active(); i++) {
+        oled_begin_frame();
+        marquee_step();
+        oled_update();
+    }
+}
+
+static void capture(uint8_t out[SIM_PAGES][SIM_WIDTH])
+{
+    memcpy(out, sim_gddram, sizeof(sim_gddram));
+}
+
+/* ================= PBM FILES ================= */
+
+// Binary PBM (P4): rows of 16 bytes, MSB first, 1 = lit
+static int pbm_write(const char *path, uint8_t ram[SIM_PAGES][SIM_WIDTH])
+{
+    FILE *f = fopen(path, "wb");
+    if (f == NULL) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    fprintf(f, "P4\n%d %d\n", SIM_WIDTH, SIM_PAGES * 8);
+    for (int y = 0; y < SIM_PAGES * 8; y++) {
+        uint8_t row[SIM_WIDTH / 8] = {0};
+        for (int x = 0; x < SIM_WIDTH; x++) {
+            if ((ram[y >> 3][x] >> (y & 7)) & 1) {
+                row[x >> 3] |= 0x80 >> (x & 7);
+            }
+        }
+        fwrite(row, 1, sizeof(row), f);
+    }
+    return fclose(f);
+}
+
+static int pbm_read(const char *path, uint8_t ram[SIM_PAGES][SIM_WIDTH])
+{
+    FILE *f = fopen(path, "rb");
+    if (f == NULL) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    int w = 0, h = 0;
+    if (fscanf(f, "P4 %d %d", &w, &h) != 2 || fgetc(f) == EOF || w != SIM_WIDTH || h != SIM_PAGES * 8) {
+        fprintf(stderr, "%s: not a %dx%d P4 image\n", path, SIM_WIDTH, SIM_PAGES * 8);
+        fclose(f);
+        return -1;
+    }
+    memset(ram, 0, SIM_PAGES * SIM_WIDTH);
+    for (int y = 0; y < h; y++) {
+        uint8_t row[SIM_WIDTH / 8];
+        if (fread(row, 1, sizeof(row), f) != sizeof(row)) {
+            fprintf(stderr, "%s: truncated\n", path);
+            fclose(f);
+            return -1;
+        }
+        for (int x = 0; x < SIM_WIDTH; x++) {
+            if (row[x >> 3] & (0x80 >> (x & 7))) {
+                ram[y >> 3][x] |= 1 << (y & 7);
+            }
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+/* ================= GOLDEN / CHECK ================= */
+
+// Every screen is drawn twice: after the previous screen, so only the
+// difference goes over the bus, and from a cleared panel. Both must leave
+// the same picture, or the dirty-range tracking lost something.
+static int render_all(const char *out_dir, const char *golden_dir)
+{
+    static uint8_t incremental[SIM_PAGES][SIM_WIDTH];
+    static uint8_t fresh[SIM_PAGES][SIM_WIDTH];
+    static uint8_t golden[SIM_PAGES][SIM_WIDTH];
+    char path[512];
+    int failures = 0;
+
+    for (size_t i = 0; i < FIXTURE_COUNT; i++) {
+        const fixture_t *f = &fixtures[i];
+
+        show(f);
+        capture(incremental);
+
+        memset(sim_gddram, 0, sizeof(sim_gddram));
+        oled_reset();
+        show(f);
+        capture(fresh);
+
+        if (memcmp(incremental, fresh, sizeof(fresh)) != 0) {
+            fprintf(stderr, "FAIL %s: partial update differs from full redraw\n", f->name);
+            failures++;
+        }
+
+        snprintf(path, sizeof(path), "%s/%s.pbm", out_dir, f->name);
+        if (pbm_write(path, fresh) != 0) return 1;
+
+        if (golden_dir == NULL) continue;
+
+        snprintf(path, sizeof(path), "%s/%s.pbm", golden_dir, f->name);
+        if (pbm_read(path, golden) != 0) {
+            failures++;
+            continue;
+        }
+        int diff = 0;
+        for (int y = 0; y < SIM_PAGES * 8; y++) {
+            for (int x = 0; x < SIM_WIDTH; x++) {
+                diff += ((fresh[y >> 3][x] ^ golden[y >> 3][x]) >> (y & 7)) & 1;
+            }
+        }
+        if (diff != 0) {
+            fprintf(stderr, "FAIL %s: %d pixels differ from %s (actual: %s/%s.pbm)\n",
+                    f->name, diff, path, out_dir, f->name);
+            failures++;
+        }
+    }
+
+    if (sim_protocol_error) {
+        fprintf(stderr, "FAIL: panel driver sent traffic the SSD1306 would reject\n");
+        failures++;
+    }
+    if (failures == 0) {
+        printf("%zu screens %s\n", FIXTURE_COUNT, golden_dir ? "match the golden images" : "written");
+    }
+    return failures ? 1 : 0;
+}
+
+/* ================= BENCHMARK ================= */
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// Times each screen drawn over the startup screen: the render into the
+// back buffer, and the diff plus bus writes in oled_update. The bus figures
+// are what actually goes over I2C; at 400 kHz each byte takes 9 clocks.
+static int bench(int iterations)
+{
+    static const fixture_t base = { "startup", { .screen = SCREEN_STARTUP } };
+
+    printf("%-28s %10s %10s %8s %8s %10s\n",
+           "screen", "render ns", "update ns", "xfers", "bytes", "i2c us");
+
+    for (size_t i = 0; i < FIXTURE_COUNT; i++) {
+        const fixture_t *f = &fixtures[i];
+        double render_total = 0, update_total = 0;
+        sim_bus_stats_t bus = {0};
+
+        for (int n = 0; n < iterations; n++) {
+            show(&base);
+
+            oled_begin_frame();
+            double t0 = now_ns();
+            render_screen(&f->desc);
+            double t1 = now_ns();
+            sim_bus_stats_t before = sim_stats;
+            oled_update();
+            double t2 = now_ns();
+
+            render_total += t1 - t0;
+            update_total += t2 - t1;
+            bus.transfers = sim_stats.transfers - before.transfers;
+            bus.bytes = sim_stats.bytes - before.bytes;
+        }
+
+        printf("%-28s %10.0f %10.0f %8u %8u %10.0f\n", f->name,
+               render_total / iterations, update_total / iterations,
+               bus.transfers, bus.bytes, bus.bytes * 9 * 1e6 / PANEL_I2C_FREQ_HZ);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (panel_init() != ESP_OK) {
+        fprintf(stderr, "panel_init failed\n");
+        return 1;
+    }
+    oled_reset();
+
+    if (argc == 3 && strcmp(argv[1], "golden") == 0) {
+        return render_all(argv[2], NULL);
+    }
+    if (argc == 4 && strcmp(argv[1], "check") == 0) {
+        return render_all(argv[3], argv[2]);
+    }
+    if ((argc == 2 || argc == 3) && strcmp(argv[1], "bench") == 0) {
+        int iterations = argc == 3 ? atoi(argv[2]) : 2000;
+        return bench(iterations > 0 ? iterations : 1);
+    }
+
+    fprintf(stderr,
+            "usage: %s golden OUT_DIR\n"
+            "       %s check GOLDEN_DIR OUT_DIR\n"
+            "       %s bench [ITERATIONS]\n",
+            argv[0], argv[0], argv[0]);
+    return 2;
+}
@@ -0,0 +1,173 @@
+/*
+ * SSD1306 emulator behind the stub I2C master driver (driver/i2c_master.h)
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "driver/i2c_master.h"
+#include "ssd1306_sim.h"
+
+uint8_t sim_gddram[SIM_PAGES][SIM_WIDTH];
+sim_bus_stats_t sim_stats;
+bool sim_protocol_error = false;
+
+// Handles only need to be distinct non-NULL pointers
+static int sim_bus_token;
+static int sim_dev_token;
+
+static int col_start = 0, col_end = SIM_WIDTH - 1;
+static int page_start = 0, page_end = SIM_PAGES - 1;
+static int col = 0, page = 0;
+static int memory_mode = 2;         // Page addressing after reset
+
+// Command being assembled: opcode plus the argument bytes it still needs
+static uint8_t cmd_buf[8];
+static int cmd_len = 0;
+static int cmd_need = 0;
+
+static void sim_error(const char *what, int value)
+{
+    fprintf(stderr, "ssd1306_sim: %s (0x%02X)\n", what, value);
+    sim_protocol_error = true;
+}
+
+static int cmd_arg_count(uint8_t op)
+{
+    switch (op) {
+    case 0x20: case 0x81: case 0x8D: case 0xA8: case 0xD3:
+    case 0xD5: case 0xD9: case 0xDA: case 0xDB:
+        return 1;
+    case 0x21: case 0x22: case 0xA3:
+        return 2;
+    case 0x29: case 0x2A:
+        return 5;
+    case 0x26: case 0x27:
+        return 6;
+    default:
+        return 0;
+    }
+}
+
+static void cmd_execute(void)
+{
+    uint8_t op = cmd_buf[0];
+
+    switch (op) {
+    case 0x20:
+        memory_mode = cmd_buf[1] & 0x03;
+        break;
+    case 0x21:
+        col_start = cmd_buf[1] & 0x7F;
+        col_end = cmd_buf[2] & 0x7F;
+        col = col_start;
+        break;
+    case 0x22:
+        page_start = cmd_buf[1] & 0x07;
+        page_end = cmd_buf[2] & 0x07;
+        page = page_start;
+        break;
+    default:
+        if (op >= 0xB0 && op <= 0xB7) {
+            page = op & 0x07;           // Page addressing mode only
+        } else if (op <= 0x0F) {
+            col = (col & 0xF0) | op;
+        } else if (op >= 0x10 && op <= 0x17) {
+            col = (col & 0x0F) | ((op & 0x07) << 4);
+        }
+        break;
+    }
+}
+
+static void cmd_byte(uint8_t b)
+{
+    if (cmd_len == 0) {
+        cmd_buf[cmd_len++] = b;
+        cmd_need = cmd_arg_count(b);
+    } else {
+        cmd_buf[cmd_len++] = b;
+        cmd_need--;
+    }
+    if (cmd_need == 0) {
+        cmd_execute();
+        cmd_len = 0;
+    }
+}
+
+static void data_byte(uint8_t b)
+{
+    if (memory_mode != 0) {
+        sim_error("data written outside horizontal addressing mode", memory_mode);
+        return;
+    }
+    sim_gddram[page][col] = b;
+    sim_stats.data_bytes++;
+
+    if (col < col_end) {
+        col++;
+        return;
+    }
+    col = col_start;
+    page = page < page_end ? page + 1 : page_start;
+}
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t *config, i2c_master_bus_handle_t *ret_bus)
+{
+    *ret_bus = (i2c_master_bus_handle_t)&sim_bus_token;
+    return ESP_OK;
+}
+
+esp_err_t i2c_del_master_bus(i2c_master_bus_handle_t bus)
+{
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus, const i2c_device_config_t *config,
+                                    i2c_master_dev_handle_t *ret_dev)
+{
+    *ret_dev = (i2c_master_dev_handle_t)&sim_dev_token;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_rm_device(i2c_master_dev_handle_t dev)
+{
+    return ESP_OK;
+}
+
+// Each control byte says whether what follows is commands (D/C# = 0) or
+// data (D/C# = 1); with Co set it covers one byte and another control byte
+// follows, otherwise it covers the rest of the transaction.
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t dev, const uint8_t *buf, size_t len, int timeout_ms)
+{
+    sim_stats.transfers++;
+    sim_stats.bytes += len;
+
+    size_t i = 0;
+    while (i < len) {
+        uint8_t ctrl = buf[i++];
+        if (ctrl & 0x3F) {
+            sim_error("bad control byte", ctrl);
+            return ESP_FAIL;
+        }
+        bool data = ctrl & 0x40;
+        size_t end = (ctrl & 0x80) ? (i < len ? i + 1 : i) : len;
+        for (; i < end; i++) {
+            if (data) {
+                data_byte(buf[i]);
+            } else {
+                cmd_byte(buf[i]);
+            }
+        }
+    }
+
+    if (cmd_len != 0) {
+        sim_error("transaction ended inside a command", cmd_buf[0]);
+        cmd_len = 0;
+    }
+    return ESP_OK;
+}
+
+bool sim_pixel(int x, int y)
+{
+    return (sim_gddram[y >> 3][x] >> (y & 7)) & 1;
+}
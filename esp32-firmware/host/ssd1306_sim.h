@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+ * SSD1306 emulated behind the stub I2C master driver. Only what the panel
+ * driver relies on is modelled: the control-byte framing, horizontal
+ * addressing with column/page windows, and display RAM. Everything else is
+ * accepted and ignored, with its argument bytes skipped.
+ */
+
+#define SIM_WIDTH   128
+#define SIM_PAGES   8
+
+// Display RAM as the controller holds it: one byte per column per page,
+// bit 0 at the top
+extern uint8_t sim_gddram[SIM_PAGES][SIM_WIDTH];
+
+typedef struct {
+    uint32_t transfers;     // I2C transactions
+    uint32_t bytes;         // Bytes on the wire after the address byte
+    uint32_t data_bytes;    // Bytes written to display RAM
+} sim_bus_stats_t;
+
+extern sim_bus_stats_t sim_stats;
+
+// Set when the driver sends something the emulator can't make sense of
+extern bool sim_protocol_error;
+
+// Pixel at (x, y) as the panel would show it
+bool sim_pixel(int x, int y);
@@ -0,0 +1,3 @@
+#pragma once
+
+/* Host builds drive the panel over I2C only; panel.c's SPI path is compiled out */
@@ -0,0 +1,10 @@
+#pragma once
+
+/* Host stand-in for ESP-IDF's esp_log.h: errors and warnings go to stderr */
+
+#include <stdio.h>
+
+#define ESP_LOGE(tag, fmt, ...) fprintf(stderr, "E (%s) " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) fprintf(stderr, "W (%s) " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) do { (void)(tag); } while (0)
+#define ESP_LOGD(tag, fmt, ...) do { (void)(tag); } while (0)
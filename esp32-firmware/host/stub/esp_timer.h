@@ -0,0 +1,36 @@
+#pragma once
+
+/* Host stand-in: timers are created but never fire */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef void (*esp_timer_cb_t)(void *arg);
+typedef struct esp_timer *esp_timer_handle_t;
+
+typedef struct {
+    esp_timer_cb_t callback;
+    void *arg;
+    const char *name;
+} esp_timer_create_args_t;
+
+static inline esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out)
+{
+    (void)args;
+    *out = (esp_timer_handle_t)1;
+    return ESP_OK;
+}
+
+static inline esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeout_us)
+{
+    (void)timer; (void)timeout_us;
+    return ESP_OK;
+}
+
+static inline esp_err_t esp_timer_stop(esp_timer_handle_t timer)
+{
+    (void)timer;
+    return ESP_OK;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+/* Host stand-in: power save only; the driver always accepts the setting */
+
+#include "esp_err.h"
+
+typedef enum { WIFI_PS_NONE, WIFI_PS_MIN_MODEM, WIFI_PS_MAX_MODEM } wifi_ps_type_t;
+
+static inline esp_err_t esp_wifi_set_ps(wifi_ps_type_t type)
+{
+    (void)type;
+    return ESP_OK;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+/* Host stand-in: only the tick helpers the display code uses */
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+
+#define portMAX_DELAY       ((TickType_t)0xFFFFFFFF)
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
@@ -0,0 +1,27 @@
+#pragma once
+
+/* Host stand-in: single-threaded, so the mutex is a token */
+
+#include "freertos/FreeRTOS.h"
+
+typedef void *SemaphoreHandle_t;
+
+#define pdTRUE 1
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    static int token;
+    return &token;
+}
+
+static inline int xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    (void)sem; (void)ticks;
+    return pdTRUE;
+}
+
+static inline int xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    (void)sem;
+    return pdTRUE;
+}
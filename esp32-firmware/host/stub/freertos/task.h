@@ -0,0 +1,9 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+// Panel power-up delays don't matter against the emulated controller
+static inline void vTaskDelay(TickType_t ticks)
+{
+    (void)ticks;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+/* Host stand-in: there is no flash; writes are accepted and forgotten */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#define ESP_ERR_NVS_NOT_FOUND   0x1102
+
+typedef uint32_t nvs_handle_t;
+typedef enum { NVS_READONLY, NVS_READWRITE } nvs_open_mode_t;
+
+static inline esp_err_t nvs_open(const char *ns, nvs_open_mode_t mode, nvs_handle_t *handle)
+{
+    (void)ns; (void)mode;
+    *handle = 1;
+    return ESP_OK;
+}
+
+static inline esp_err_t nvs_get_u8(nvs_handle_t handle, const char *key, uint8_t *value)
+{
+    (void)handle; (void)key; (void)value;
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
+static inline esp_err_t nvs_set_u8(nvs_handle_t handle, const char *key, uint8_t value)
+{
+    (void)handle; (void)key; (void)value;
+    return ESP_OK;
+}
+
+static inline esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    (void)handle;
+    return ESP_OK;
+}
+
+static inline void nvs_close(nvs_handle_t handle)
+{
+    (void)handle;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+/* Host stand-in: the HID usage IDs the keymap decodes */
+
+enum {
+    HID_KEY_A       = 0x04,
+    HID_KEY_Z       = 0x1D,
+    HID_KEY_1       = 0x1E,
+    HID_KEY_9       = 0x26,
+    HID_KEY_0       = 0x27,
+    HID_KEY_ENTER   = 0x28,
+    HID_KEY_MINUS   = 0x2D,
+};
@@ -0,0 +1,613 @@
+/*
+ * OLED framebuffer, text drawing and screen layouts.
+ *
+ * Screens render into a 1-bit-per-pixel page-packed back buffer; oled_update
+ * diffs it against what the panel shows and sends the changed column ranges
+ * through panel.c. Static screens come from the generated assets.h.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#include "panel.h"
+#include "assets.h"  // Generated at build time by tools/gen_assets.py
+#include "display_render.h"
+
+/* ================= 5x7 FONT ================= */
+
+// FONT5X7_GLYPHS comes from the generated assets.h: one X(c0, .., c4)
+// entry per glyph for FONT5X7_FIRST_CHAR..FONT5X7_LAST_CHAR, each byte a
+// column with bit 0 at the top row. The source is the pixel-art
+// assets/font5x7.txt. The list is expanded into the 5x7 table and, at
+// compile time, into its vertically doubled 2x copy.
+#define FONT_GLYPH(c0, c1, c2, c3, c4) {c0, c1, c2, c3, c4},
+
+static const uint8_t font5x7[][5] = {
+    FONT5X7_GLYPHS(FONT_GLYPH)
+};
+
+// Each of the 7 rows becomes two, so a 2x column is a 14-bit value
+#define FONT_DOUBLE_ROWS(b) ((uint16_t)( \
+    (((b) & 0x01) ? 0x0003 : 0) | (((b) & 0x02) ? 0x000C : 0) | \
+    (((b) & 0x04) ? 0x0030 : 0) | (((b) & 0x08) ? 0x00C0 : 0) | \
+    (((b) & 0x10) ? 0x0300 : 0) | (((b) & 0x20) ? 0x0C00 : 0) | \
+    (((b) & 0x40) ? 0x3000 : 0)))
+
+#define FONT_GLYPH_2X(c0, c1, c2, c3, c4) { \
+    FONT_DOUBLE_ROWS(c0), FONT_DOUBLE_ROWS(c1), FONT_DOUBLE_ROWS(c2), \
+    FONT_DOUBLE_ROWS(c3), FONT_DOUBLE_ROWS(c4) },
+
+static const uint16_t font5x7_2x[][5] = {
+    FONT5X7_GLYPHS(FONT_GLYPH_2X)
+};
+
+/* ================= OLED FRAME BUFFER ================= */
+
+#define OLED_WIDTH   PANEL_WIDTH
+#define OLED_HEIGHT  PANEL_HEIGHT
+#define OLED_PAGES   PANEL_PAGES
+#define OLED_FB_SIZE (OLED_WIDTH * OLED_PAGES)
+
+_Static_assert(ASSET_SCREEN_WIDTH == OLED_WIDTH && ASSET_SCREEN_PAGES <= OLED_PAGES,
+               "Generated screen images don't fit the panel");
+
+// Double buffered: render_* functions draw into the back buffer
+// (oled_buffer) while the front buffer holds what the panel is showing.
+// oled_update sends the difference and swaps the two. The front is invalid
+// until a full frame has been written after init.
+static uint8_t oled_frames[2][OLED_FB_SIZE];
+static uint8_t *oled_buffer = oled_frames[0];
+static uint8_t *oled_front = oled_frames[1];
+static bool oled_front_valid = false;
+
+// Per-page column range touched since the last oled_update (lo > hi: clean)
+static uint8_t oled_dirty_lo[OLED_PAGES];
+static uint8_t oled_dirty_hi[OLED_PAGES];
+
+/* ================= OLED DISPLAY FUNCTIONS ================= */
+
+static void oled_mark_dirty(int page, int x0, int x1)
+{
+    if (oled_dirty_lo[page] > oled_dirty_hi[page]) {
+        oled_dirty_lo[page] = x0;
+        oled_dirty_hi[page] = x1;
+        return;
+    }
+    if (x0 < oled_dirty_lo[page]) oled_dirty_lo[page] = x0;
+    if (x1 > oled_dirty_hi[page]) oled_dirty_hi[page] = x1;
+}
+
+static void oled_mark_all_dirty(void)
+{
+    for (int page = 0; page < OLED_PAGES; page++) {
+        oled_dirty_lo[page] = 0;
+        oled_dirty_hi[page] = OLED_WIDTH - 1;
+    }
+}
+
+static void oled_clear(void)
+{
+    memset(oled_buffer, 0, OLED_FB_SIZE);
+    oled_mark_all_dirty();
+}
+
+void oled_reset(void)
+{
+    memset(oled_frames, 0, sizeof(oled_frames));
+    oled_mark_all_dirty();
+    oled_front_valid = false;  // Panel RAM is undefined after power-up
+}
+
+// Starts a frame in the back buffer from what the panel shows, so a render
+// only marks what it actually changes
+void oled_begin_frame(void)
+{
+    memcpy(oled_buffer, oled_front, OLED_FB_SIZE);
+}
+
+// Sends only what changed: each page's dirty range is trimmed against the
+// front buffer and handed to the panel driver, then the buffers swap. On
+// SPI the pages go out by DMA while the next frame renders into the other
+// buffer; the wait up front keeps the buffer being sent from being reused.
+void oled_update(void)
+{
+    panel_wait();
+
+    for (int page = 0; page < OLED_PAGES; page++) {
+        int lo = oled_dirty_lo[page];
+        int hi = oled_dirty_hi[page];
+        oled_dirty_lo[page] = OLED_WIDTH - 1;
+        oled_dirty_hi[page] = 0;
+        if (lo > hi) continue;
+
+        uint8_t *row = &oled_buffer[page * OLED_WIDTH];
+        uint8_t *shown = &oled_front[page * OLED_WIDTH];
+        if (oled_front_valid) {
+            while (lo <= hi && row[lo] == shown[lo]) lo++;
+            while (hi >= lo && row[hi] == shown[hi]) hi--;
+            if (lo > hi) continue;
+        } else {
+            lo = 0;
+            hi = OLED_WIDTH - 1;
+        }
+
+        if (panel_write_page(page, lo, hi, row) != ESP_OK) {
+            // Whatever the panel holds now is unknown; resend everything next time
+            oled_front_valid = false;
+            oled_mark_all_dirty();
+            return;
+        }
+    }
+
+    uint8_t *shown = oled_front;
+    oled_front = oled_buffer;
+    oled_buffer = shown;
+    oled_front_valid = true;
+}
+
+// Glyphs are ORed in a column byte at a time. A column with bit 0 at row
+// y lands in page y / 8 shifted down by y % 8; whatever spills past the
+// bottom of that page goes into the next one. Page-aligned text is a single
+// OR per column.
+static void oled_blit_columns(int x, int y, const uint16_t *cols, int count, int repeat)
+{
+    if (x < 0 || x >= OLED_WIDTH || y < 0 || y >= OLED_HEIGHT) return;
+
+    int width = count * repeat;
+    if (width > OLED_WIDTH - x) width = OLED_WIDTH - x;
+    int page = y >> 3;
+    int shift = y & 7;
+
+    for (int i = 0; i < width; i++) {
+        uint32_t bits = (uint32_t)cols[i / repeat] << shift;
+        uint8_t *p = &oled_buffer[page * OLED_WIDTH + x + i];
+        for (int pg = page; bits != 0 && pg < OLED_PAGES; pg++) {
+            *p |= (uint8_t)bits;
+            bits >>= 8;
+            p += OLED_WIDTH;
+        }
+    }
+
+    int last_page = (y + 15) >> 3;  // Columns are at most 16 rows tall
+    for (int pg = page; pg <= last_page && pg < OLED_PAGES; pg++) {
+        oled_mark_dirty(pg, x, x + width - 1);
+    }
+}
+
+static void oled_draw_char(int x, int y, char c)
+{
+    if (c < FONT5X7_FIRST_CHAR || c > FONT5X7_LAST_CHAR) c = ' ';
+    if (x < 0 || x >= OLED_WIDTH || y < 0 || y >= OLED_HEIGHT) return;
+
+    const uint8_t *glyph = font5x7[c - FONT5X7_FIRST_CHAR];
+    int width = OLED_WIDTH - x < 5 ? OLED_WIDTH - x : 5;
+    int page = y >> 3;
+    int shift = y & 7;
+    uint8_t *row = &oled_buffer[page * OLED_WIDTH + x];
+
+    if (shift == 0) {
+        for (int col = 0; col < width; col++) {
+            row[col] |= glyph[col];
+        }
+        oled_mark_dirty(page, x, x + width - 1);
+        return;
+    }
+
+    uint8_t *next = page < OLED_PAGES - 1 ? row + OLED_WIDTH : NULL;
+    for (int col = 0; col < width; col++) {
+        uint16_t bits = (uint16_t)glyph[col] << shift;
+        row[col] |= (uint8_t)bits;
+        if (next) next[col] |= (uint8_t)(bits >> 8);
+    }
+    oled_mark_dirty(page, x, x + width - 1);
+    if (next) oled_mark_dirty(page + 1, x, x + width - 1);
+}
+
+static void oled_draw_string(int x, int y, const char *str)
+{
+    while (*str) {
+        oled_draw_char(x, y, *str);
+        x += 6;
+        str++;
+        if (x >= OLED_WIDTH) break;
+    }
+}
+
+static void oled_draw_string_large(int x, int y, const char *str)
+{
+    while (*str) {
+        if (x >= OLED_WIDTH) break;
+        
+        if (*str >= FONT5X7_FIRST_CHAR && *str <= FONT5X7_LAST_CHAR) {
+            oled_blit_columns(x, y, font5x7_2x[*str - FONT5X7_FIRST_CHAR], 5, 2);
+        }
+        x += 12;
+        str++;
+    }
+}
+
+// Replaces the whole back buffer with a build-time screen image (see
+// tools/gen_assets.py for the RLE format). Rows below the image are cleared.
+static void oled_draw_image(asset_image_t img)
+{
+    uint8_t *out = oled_buffer;
+    uint8_t *out_end = oled_buffer + ASSET_SCREEN_WIDTH * ASSET_SCREEN_PAGES;
+    const uint8_t *in = img.rle;
+    const uint8_t *in_end = img.rle + img.size;
+
+    while (in < in_end && out < out_end) {
+        uint8_t ctrl = *in++;
+        int n = (ctrl & 0x7F) + 1;
+        if (n > out_end - out) n = out_end - out;
+        if (ctrl & 0x80) {
+            memset(out, *in++, n);
+        } else {
+            memcpy(out, in, n);
+            in += n;
+        }
+        out += n;
+    }
+    memset(out, 0, oled_buffer + OLED_FB_SIZE - out);
+    oled_mark_all_dirty();
+}
+
+/* ================= MARQUEE ================= */
+
+// One text field per screen may be wider than the space left on its line.
+// It is drawn as a strip (text + gap) wrapping around, and the display task
+// advances it every MARQUEE_STEP_MS. Only the field's own rows are redrawn,
+// so the dirty-range update sends just that band.
+
+typedef struct {
+    bool active;
+    char text[SCREEN_TEXT_MAX_LEN];
+    int len;
+    int x;
+    int y;
+    int strip_width;
+    int offset;
+    int pause;
+} marquee_t;
+
+static marquee_t marquee = {0};
+
+static void marquee_draw(void)
+{
+    int page = marquee.y >> 3;
+    int shift = marquee.y & 7;
+    uint16_t rows = (uint16_t)0x7F << shift;  // The 7 glyph rows at y
+    uint8_t *row = &oled_buffer[page * OLED_WIDTH];
+    uint8_t *next = page < OLED_PAGES - 1 ? row + OLED_WIDTH : NULL;
+
+    for (int x = marquee.x; x < OLED_WIDTH; x++) {
+        int s = (marquee.offset + x - marquee.x) % marquee.strip_width;
+        int ch = s / 6;
+        int col = s % 6;
+        uint8_t bits = 0;
+        if (ch < marquee.len && col < 5) {
+            char c = marquee.text[ch];
+            if (c < FONT5X7_FIRST_CHAR || c > FONT5X7_LAST_CHAR) c = ' ';
+            bits = font5x7[c - FONT5X7_FIRST_CHAR][col];
+        }
+
+        uint16_t shifted = (uint16_t)bits << shift;
+        row[x] = (row[x] & ~(uint8_t)rows) | (uint8_t)shifted;
+        if (next) {
+            next[x] = (next[x] & ~(uint8_t)(rows >> 8)) | (uint8_t)(shifted >> 8);
+        }
+    }
+
+    oled_mark_dirty(page, marquee.x, OLED_WIDTH - 1);
+    if (next && shift > 1) oled_mark_dirty(page + 1, marquee.x, OLED_WIDTH - 1);
+}
+
+// Draws str at (x, y); if it doesn't fit before the right edge it becomes
+// the screen's marquee instead of being cut off
+static void oled_draw_field(int x, int y, const char *str)
+{
+    int len = strlen(str);
+    if (x + len * 6 - 1 <= OLED_WIDTH || marquee.active) {
+        oled_draw_string(x, y, str);
+        return;
+    }
+
+    if (len > (int)sizeof(marquee.text) - 1) len = sizeof(marquee.text) - 1;
+    memcpy(marquee.text, str, len);
+    marquee.text[len] = '\0';
+    marquee.len = len;
+    marquee.x = x;
+    marquee.y = y;
+    marquee.strip_width = len * 6 + MARQUEE_GAP_PX;
+    marquee.offset = 0;
+    marquee.pause = MARQUEE_PAUSE_STEPS;
+    marquee.active = true;
+    marquee_draw();
+}
+
+bool marquee_active(void)
+{
+    return marquee.active;
+}
+
+void marquee_step(void)
+{
+    if (marquee.pause > 0) {
+        marquee.pause--;
+        return;
+    }
+    marquee.offset += MARQUEE_STEP_PX;
+    if (marquee.offset >= marquee.strip_width) {
+        marquee.offset = 0;
+        marquee.pause = MARQUEE_PAUSE_STEPS;
+    }
+    marquee_draw();
+}
+
+/* ================= DISPLAY SCREENS ================= */
+
+// Screens whose text never changes are drawn by the build from
+// assets/screens.txt; the ones with a field start from that image.
+
+static void render_startup(void)
+{
+    oled_draw_image(ASSET_SCREEN_STARTUP);
+}
+
+static void render_scanning(const char *barcode)
+{
+    oled_draw_image(ASSET_SCREEN_SCANNING);
+    oled_draw_field(10, 42, barcode);
+}
+
+static void render_not_found(const char *barcode)
+{
+    oled_draw_image(ASSET_SCREEN_NOT_FOUND);
+    oled_draw_field(5, 37, barcode);
+}
+
+static const char* get_status_text(const char *stock_health)
+{
+    if (stock_health == NULL || stock_health[0] == '\0' || strcmp(stock_health, "healthy") == 0) {
+        return "Healthy";
+    } else if (strcmp(stock_health, "low") == 0) {
+        return "Low";
+    } else if (strcmp(stock_health, "out_of_stock") == 0) {
+        return "Out of Stock";
+    } else {
+        return "Healthy";
+    }
+}
+
+static void render_out_of_stock(const char *name, const char *category)
+{
+    oled_clear();
+    oled_draw_string_large(0, 0, "OUT OF STOCK");
+    
+    oled_draw_field(0, 20, name);
+    
+    char cat_line[22];
+    snprintf(cat_line, sizeof(cat_line), "Cat: %.16s", category);
+    oled_draw_string(0, 32, cat_line);
+    
+    oled_draw_string(0, 44, "Stock: 0");
+    oled_draw_string(0, 56, "Status: Out of Stock");
+}
+
+static void render_success(const char *name, const char *category, int new_stock)
+{
+    oled_clear();
+    oled_draw_string_large(10, 0, "SCANNED!");
+    
+    oled_draw_field(0, 20, name);
+    
+    char cat_line[22];
+    snprintf(cat_line, sizeof(cat_line), "Cat: %.16s", category);
+    oled_draw_string(0, 32, cat_line);
+    
+    char stock_line[22];
+    snprintf(stock_line, sizeof(stock_line), "New Stock: %d", new_stock);
+    oled_draw_string(0, 48, stock_line);
+}
+
+static void render_added(const char *name, const char *category, int quantity_added, int new_stock, const char *stock_health)
+{
+    oled_clear();
+    
+    char add_line[22];
+    snprintf(add_line, sizeof(add_line), "ADDED +%d", quantity_added);
+    oled_draw_string_large(5, 0, add_line);
+    
+    oled_draw_field(0, 20, name);
+    
+    char cat_line[22];
+    snprintf(cat_line, sizeof(cat_line), "Cat: %.16s", category);
+    oled_draw_string(0, 32, cat_line);
+    
+    char stock_line[22];
+    snprintf(stock_line, sizeof(stock_line), "New Stock: %d", new_stock);
+    oled_draw_string(0, 44, stock_line);
+    
+    char status_line[22];
+    snprintf(status_line, sizeof(status_line), "Status: %s", get_status_text(stock_health));
+    oled_draw_string(0, 56, status_line);
+}
+
+static void render_deducted(const char *name, const char *category, int quantity_deducted, int new_stock, const char *stock_health)
+{
+    oled_clear();
+    
+    char deduct_line[22];
+    snprintf(deduct_line, sizeof(deduct_line), "DEDUCTED -%d", quantity_deducted);
+    oled_draw_string_large(0, 0, deduct_line);
+    
+    oled_draw_field(0, 20, name);
+    
+    char cat_line[22];
+    snprintf(cat_line, sizeof(cat_line), "Cat: %.16s", category);
+    oled_draw_string(0, 32, cat_line);
+    
+    char stock_line[22];
+    snprintf(stock_line, sizeof(stock_line), "New Stock: %d", new_stock);
+    oled_draw_string(0, 44, stock_line);
+    
+    char status_line[22];
+    snprintf(status_line, sizeof(status_line), "Status: %s", get_status_text(stock_health));
+    oled_draw_string(0, 56, status_line);
+}
+
+static void render_view_details(const char *name, const char *category, int current_stock, int original_stock, const char *stock_health)
+{
+    oled_clear();
+    oled_draw_string_large(20, 0, "DETAILS");
+    
+    oled_draw_field(0, 18, name);
+    
+    char cat_line[22];
+    snprintf(cat_line, sizeof(cat_line), "Cat: %.16s", category);
+    oled_draw_string(0, 30, cat_line);
+    
+    char stock_line[22];
+    snprintf(stock_line, sizeof(stock_line), "Stock: %d/%d", current_stock, original_stock);
+    oled_draw_string(0, 42, stock_line);
+    
+    char status_line[22];
+    snprintf(status_line, sizeof(status_line), "Status: %s", get_status_text(stock_health));
+    oled_draw_string(0, 54, status_line);
+}
+
+static void render_partial_deduction(const char *name, const char *category, int quantity_deducted, int requested, int new_stock, const char *stock_health)
+{
+    oled_clear();
+    
+    char deduct_line[22];
+    snprintf(deduct_line, sizeof(deduct_line), "PARTIAL -%d", quantity_deducted);
+    oled_draw_string_large(0, 0, deduct_line);
+    
+    oled_draw_field(0, 18, name);
+    
+    char info_line[22];
+    snprintf(info_line, sizeof(info_line), "Req:%d Got:%d", requested, quantity_deducted);
+    oled_draw_string(0, 30, info_line);
+    
+    char stock_line[22];
+    snprintf(stock_line, sizeof(stock_line), "New Stock: %d", new_stock);
+    oled_draw_string(0, 42, stock_line);
+    
+    char status_line[22];
+    snprintf(status_line, sizeof(status_line), "Status: %s", get_status_text(stock_health));
+    oled_draw_string(0, 54, status_line);
+}
+
+static void render_error(const char *message)
+{
+    oled_draw_image(ASSET_SCREEN_ERROR);
+    oled_draw_field(5, 40, message);
+}
+
+static void render_wifi_connecting(void)
+{
+    oled_draw_image(ASSET_SCREEN_WIFI_CONNECTING);
+}
+
+static void render_wifi_connected(void)
+{
+    oled_draw_image(ASSET_SCREEN_WIFI_CONNECTED);
+}
+
+static void render_cached_item(const char *name, const char *category, int projected_stock, const char *stock_health)
+{
+    oled_clear();
+    
+    oled_draw_field(0, 0, name);
+    
+    char cat_line[22];
+    snprintf(cat_line, sizeof(cat_line), "Cat: %.16s", category);
+    oled_draw_string(0, 12, cat_line);
+    
+    char stock_line[12];
+    snprintf(stock_line, sizeof(stock_line), "%d", projected_stock);
+    oled_draw_string(0, 26, "Stock:");
+    oled_draw_string_large(40, 24, stock_line);
+    
+    char status_line[22];
+    snprintf(status_line, sizeof(status_line), "Status: %s", get_status_text(stock_health));
+    oled_draw_string(0, 44, status_line);
+    
+    oled_draw_string(0, 56, "Syncing...");
+}
+
+static void render_offline_details(const char *name, const char *category, int current_stock, int original_stock, const char *stock_health)
+{
+    oled_clear();
+    oled_draw_string_large(20, 0, "OFFLINE");
+    
+    oled_draw_field(0, 18, name);
+    
+    char cat_line[22];
+    snprintf(cat_line, sizeof(cat_line), "Cat: %.16s", category);
+    oled_draw_string(0, 30, cat_line);
+    
+    char stock_line[22];
+    snprintf(stock_line, sizeof(stock_line), "Stock: %d/%d", current_stock, original_stock);
+    oled_draw_string(0, 42, stock_line);
+    
+    char status_line[22];
+    snprintf(status_line, sizeof(status_line), "Status: %s", get_status_text(stock_health));
+    oled_draw_string(0, 54, status_line);
+}
+
+/* ================= SCREEN DISPATCH ================= */
+
+void render_screen(const screen_desc_t *d)
+{
+    marquee.active = false;
+
+    switch (d->screen) {
+    case SCREEN_STARTUP:
+        render_startup();
+        break;
+    case SCREEN_SCANNING:
+        render_scanning(d->text);
+        break;
+    case SCREEN_NOT_FOUND:
+        render_not_found(d->text);
+        break;
+    case SCREEN_OUT_OF_STOCK:
+        render_out_of_stock(d->name, d->category);
+        break;
+    case SCREEN_SUCCESS:
+        render_success(d->name, d->category, d->stock);
+        break;
+    case SCREEN_ADDED:
+        render_added(d->name, d->category, d->quantity, d->stock, d->stock_health);
+        break;
+    case SCREEN_DEDUCTED:
+        render_deducted(d->name, d->category, d->quantity, d->stock, d->stock_health);
+        break;
+    case SCREEN_VIEW_DETAILS:
+        render_view_details(d->name, d->category, d->quantity, d->stock, d->stock_health);
+        break;
+    case SCREEN_PARTIAL_DEDUCTION:
+        render_partial_deduction(d->name, d->category, d->quantity, d->requested, d->stock, d->stock_health);
+        break;
+    case SCREEN_ERROR:
+        render_error(d->text);
+        break;
+    case SCREEN_WIFI_CONNECTING:
+        render_wifi_connecting();
+        break;
+    case SCREEN_WIFI_CONNECTED:
+        render_wifi_connected();
+        break;
+    case SCREEN_CACHED_ITEM:
+        render_cached_item(d->name, d->category, d->stock, d->stock_health);
+        break;
+    case SCREEN_OFFLINE_DETAILS:
+        render_offline_details(d->name, d->category, d->quantity, d->stock, d->stock_health);
+        break;
+    }
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <stdbool.h>
+
+/*
+ * Screen rendering into the OLED framebuffer, with changes sent through the
+ * panel driver. Nothing here depends on FreeRTOS or Wi-Fi, so the same code
+ * builds on the host (see host/) for golden images and benchmarks.
+ */
+
+// Marquee for text wider than the space left on its line
+#define MARQUEE_STEP_MS     50
+#define MARQUEE_STEP_PX     2
+#define MARQUEE_GAP_PX      24      // Blank columns between repeats
+#define MARQUEE_PAUSE_STEPS 20      // Hold the start of the text for 1 s
+
+// Longest barcode or error message a screen carries, NUL included
+#define SCREEN_TEXT_MAX_LEN 64
+
+typedef enum {
+    SCREEN_STARTUP,
+    SCREEN_SCANNING,
+    SCREEN_NOT_FOUND,
+    SCREEN_OUT_OF_STOCK,
+    SCREEN_SUCCESS,
+    SCREEN_ADDED,
+    SCREEN_DEDUCTED,
+    SCREEN_VIEW_DETAILS,
+    SCREEN_PARTIAL_DEDUCTION,
+    SCREEN_ERROR,
+    SCREEN_WIFI_CONNECTING,
+    SCREEN_WIFI_CONNECTED,
+    SCREEN_CACHED_ITEM,
+    SCREEN_OFFLINE_DETAILS,
+} screen_id_t;
+
+typedef struct {
+    screen_id_t screen;
+    char text[SCREEN_TEXT_MAX_LEN];  // Barcode or error message
+    char name[64];
+    char category[32];
+    char stock_health[16];
+    int quantity;                // Amount changed, or current stock
+    int stock;                   // New, projected or original stock
+    int requested;
+} screen_desc_t;
+
+// Clears both frames and forces a full resend; call after panel_init()
+void oled_reset(void);
+
+// A frame is oled_begin_frame(), then render_screen() or marquee_step(),
+// then oled_update() to send what changed
+void oled_begin_frame(void);
+void oled_update(void);
+
+// Draws a whole screen into the back buffer, replacing any running marquee
+void render_screen(const screen_desc_t *d);
+
+// True while the current screen has a field scrolling; marquee_step()
+// should then run every MARQUEE_STEP_MS
+bool marquee_active(void);
+void marquee_step(void);
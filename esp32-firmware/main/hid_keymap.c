@@ -0,0 +1,21 @@
+/*
+ * Keycode map for the USB barcode scanner (see hid_keymap.h).
+ */
+
+#include "usb/hid_usage_keyboard.h"
+
+#include "hid_keymap.h"
+
+char hid_keycode_to_ascii(uint8_t keycode)
+{
+    if (keycode >= HID_KEY_A && keycode <= HID_KEY_Z) {
+        return 'A' + (keycode - HID_KEY_A);
+    }
+    if (keycode >= HID_KEY_1 && keycode <= HID_KEY_9) {
+        return '1' + (keycode - HID_KEY_1);
+    }
+    if (keycode == HID_KEY_0) return '0';
+    if (keycode == HID_KEY_MINUS) return '-';
+    if (keycode == HID_KEY_ENTER) return '\n';
+    return 0;
+}
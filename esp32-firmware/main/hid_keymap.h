@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * HID boot-keyboard keycodes to barcode characters. Scanners in keyboard
+ * mode only need letters, digits, '-' and Enter; the modifier byte is not
+ * looked at, so letters always come out upper case and shifted symbols
+ * such as '@' or ':' cannot be produced. Configuration barcodes have to
+ * stick to this set.
+ */
+
+// Returns the character for keycode, '\n' for Enter, or 0 if unmapped
+char hid_keycode_to_ascii(uint8_t keycode);
@@ -7,13 +7,14 @@
  * Features:
  * - USB barcode scanner via HID Host
  * - WiFi connectivity
- * - SSD1306 OLED display (128x64, I2C)
+ * - SSD1306 / SH1106 / SSD1327 OLED display over I2C or SPI (see panel.h)
  * - Sends scanned barcodes to inventory management API
  * - Displays item details or error messages on OLED
  */
 
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <stdbool.h>
 #include <time.h>
 #include <stdlib.h>
@@ -30,193 +31,226 @@
 #include "esp_event.h"
 #include "esp_http_client.h"
 #include "esp_crt_bundle.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_cpu.h"
+#include "esp_partition.h"
 #include "nvs_flash.h"
-#include "driver/i2c_master.h"
+#include "nvs.h"
+#include "esp_mac.h"
+#include "esp_wnm.h"
 #include "driver/gpio.h"
 
+#include "lwip/netdb.h"
+#include "lwip/sockets.h"
+
 #include "usb/usb_host.h"
 #include "usb/hid_host.h"
 #include "usb/hid_usage_keyboard.h"
 
+#include "panel.h"
+#include "status_led.h"
+#include "wifi_power.h"
+#include "hid_keymap.h"
+#include "display_render.h"
+
 /* ================= CONFIGURATION ================= */
 
 // WiFi Configuration - UPDATE THESE
 #define WIFI_SSID           "YOUR_WIFI_SSID"
 #define WIFI_PASSWORD       "YOUR_WIFI_PASSWORD"
-#define WIFI_MAXIMUM_RETRY  5
+#define WIFI_MAXIMUM_RETRY  5       // Failed attempts before scans go offline (retries never stop)
+#define WIFI_RETRY_BASE_MS  250     // Reconnect backoff: doubles per failure...
+#define WIFI_RETRY_MAX_MS   8000    // ...up to this cap
+#define WIFI_STABLE_MS      10000   // A link that drops sooner counts as a failed attempt
+
+// Static IP - leave WIFI_STATIC_IP empty to use DHCP. DHCP asks for the
+// previous lease straight away (CONFIG_LWIP_DHCP_RESTORE_LAST_IP).
+#define WIFI_STATIC_IP      ""
+#define WIFI_STATIC_NETMASK "255.255.255.0"
+#define WIFI_STATIC_GW      ""
+#define WIFI_STATIC_DNS     ""
+
+// Last AP used, kept in NVS so boot and reconnects skip the channel scan
+#define WIFI_CACHE_NAMESPACE "wifi"
+#define WIFI_CACHE_KEY       "last_ap"
+
+// Roaming: once the AP drops below the threshold, look for a stronger one
+// while the link still works (802.11v transition request, else a scan)
+#define ROAM_RSSI_THRESHOLD  -70     // dBm
+#define ROAM_RSSI_HYSTERESIS 8       // dB a new AP must beat the current one by
+#define ROAM_RETRY_MS        10000   // Quiet time before the next roam check
+#define ROAM_SCAN_MAX_APS    8
+#define ROAM_HOLD_MS         3000    // Longest a scan waits for a planned roam to finish
 
 // Inventory API Configuration - UPDATE THIS TO YOUR DEPLOYED APP URL
 #define API_BASE_URL        "https://YOUR-REPLIT-APP.replit.app"
 #define API_SCAN_ENDPOINT   "/api/scan"
+#define API_HEALTH_ENDPOINT "/healthz"
+#define API_CATALOG_ENDPOINT "/api/catalog"
+#define API_CATALOG_DELTA_ENDPOINT "/api/catalog/delta"
+#define API_BARCODE_FILTER_ENDPOINT "/api/barcode-filter"
 
-// OLED Display Configuration (SSD1306 128x64)
-#define I2C_MASTER_SCL_IO   9
-#define I2C_MASTER_SDA_IO   8
-#define I2C_MASTER_FREQ_HZ  400000
-#define OLED_ADDR           0x3C
+// Connection pre-warming (DNS + TLS handshake right after Wi-Fi comes up)
+#define DNS_CACHE_TTL_MS    300000  // Re-resolve the API host after 5 minutes
+#define API_KEEPALIVE_MS    20000   // Ping an idle API connection so proxies and the server keep it open
+#define HTTP_TIMEOUT_MS     15000
+
+// OLED Display: controller, bus, geometry and wiring are set in panel.h
 
 // Barcode Settings
 #define BARCODE_MAX_LEN     64
+#define SCAN_QUEUE_LEN      16      // Scans held while the network comes up
 #define HTTP_RESPONSE_MAX   1024
 
-// LED Configuration (Stock Health Indicators)
-#define LED_GREEN_GPIO      4   // Healthy stock
-#define LED_YELLOW_GPIO     5   // Low stock
-#define LED_RED_GPIO        6   // Out of stock
+// On-device item cache (optimistic display for repeat scans)
+#define ITEM_CACHE_SIZE     32
+
+// Item catalog snapshot (memory-mapped flash partition, see server/catalog.ts)
+#define CATALOG_PARTITION_LABEL   "catalog"
+#define CATALOG_IMAGE_MAGIC       0x54414349  // "ICAT"
+#define CATALOG_DELTA_MAGIC       0x4c444349  // "ICDL"
+#define CATALOG_FORMAT            1
+#define CATALOG_FLAG_DELETED      0x01
+#define CATALOG_OVERLAY_SIZE      64      // Delta records held in RAM before a full re-download
+#define CATALOG_SYNC_INTERVAL_MS  60000
+
+// Known-barcode Bloom filter (short-circuits NOT_FOUND scans)
+#define BARCODE_FILTER_MAGIC       0x464c4249  // "IBLF"
+#define BARCODE_FILTER_MAX_BYTES   32768
+#define BARCODE_FILTER_TRUST_MS    (API_KEEPALIVE_MS + 5000)  // A miss skips the server only this soon after a check
+
+// Status LEDs: pins and patterns are set in status_led.h
+
+// Wi-Fi power save: policies and the adaptive idle time are set in wifi_power.h
 
 // Task Stack Sizes (increased for stability)
 #define USB_HOST_TASK_STACK_SIZE    8192
 #define API_TASK_STACK_SIZE         12288
 #define HID_TASK_STACK_SIZE         8192
+#define NET_WARMUP_TASK_STACK_SIZE  8192
+#define DISPLAY_TASK_STACK_SIZE     4096
 
-static const char *TAG = "INVENTORY_SCANNER";
+// How long "CONNECTED" stays up at boot before the ready screen, unless a
+// scan replaces it first
+#define WIFI_CONNECTED_SCREEN_MS    1500
 
-/* ================= I2C MASTER HANDLE ================= */
-
-static i2c_master_bus_handle_t i2c_bus_handle = NULL;
-static i2c_master_dev_handle_t oled_dev_handle = NULL;
-static bool oled_ready = false;  // Only true after full successful init
-
-/* ================= OLED DISPLAY COMMANDS ================= */
-
-#define OLED_CMD_DISPLAY_OFF        0xAE
-#define OLED_CMD_DISPLAY_ON         0xAF
-#define OLED_CMD_SET_MUX_RATIO      0xA8
-#define OLED_CMD_SET_DISPLAY_OFFSET 0xD3
-#define OLED_CMD_SET_START_LINE     0x40
-#define OLED_CMD_SET_SEG_REMAP      0xA1
-#define OLED_CMD_SET_COM_SCAN_DEC   0xC8
-#define OLED_CMD_SET_COM_PINS       0xDA
-#define OLED_CMD_SET_CONTRAST       0x81
-#define OLED_CMD_ENTIRE_DISPLAY_ON  0xA4
-#define OLED_CMD_SET_NORMAL_DISPLAY 0xA6
-#define OLED_CMD_SET_OSC_FREQ       0xD5
-#define OLED_CMD_SET_CHARGE_PUMP    0x8D
-#define OLED_CMD_SET_MEMORY_MODE    0x20
-#define OLED_CMD_SET_COL_ADDR       0x21
-#define OLED_CMD_SET_PAGE_ADDR      0x22
-
-/* ================= 5x7 FONT ================= */
-
-static const uint8_t font5x7[][5] = {
-    {0x00, 0x00, 0x00, 0x00, 0x00}, // Space
-    {0x00, 0x00, 0x5F, 0x00, 0x00}, // !
-    {0x00, 0x07, 0x00, 0x07, 0x00}, // "
-    {0x14, 0x7F, 0x14, 0x7F, 0x14}, // #
-    {0x24, 0x2A, 0x7F, 0x2A, 0x12}, // $
-    {0x23, 0x13, 0x08, 0x64, 0x62}, // %
-    {0x36, 0x49, 0x55, 0x22, 0x50}, // &
-    {0x00, 0x05, 0x03, 0x00, 0x00}, // '
-    {0x00, 0x1C, 0x22, 0x41, 0x00}, // (
-    {0x00, 0x41, 0x22, 0x1C, 0x00}, // )
-    {0x08, 0x2A, 0x1C, 0x2A, 0x08}, // *
-    {0x08, 0x08, 0x3E, 0x08, 0x08}, // +
-    {0x00, 0x50, 0x30, 0x00, 0x00}, // ,
-    {0x08, 0x08, 0x08, 0x08, 0x08}, // -
-    {0x00, 0x60, 0x60, 0x00, 0x00}, // .
-    {0x20, 0x10, 0x08, 0x04, 0x02}, // /
-    {0x3E, 0x51, 0x49, 0x45, 0x3E}, // 0
-    {0x00, 0x42, 0x7F, 0x40, 0x00}, // 1
-    {0x42, 0x61, 0x51, 0x49, 0x46}, // 2
-    {0x21, 0x41, 0x45, 0x4B, 0x31}, // 3
-    {0x18, 0x14, 0x12, 0x7F, 0x10}, // 4
-    {0x27, 0x45, 0x45, 0x45, 0x39}, // 5
-    {0x3C, 0x4A, 0x49, 0x49, 0x30}, // 6
-    {0x01, 0x71, 0x09, 0x05, 0x03}, // 7
-    {0x36, 0x49, 0x49, 0x49, 0x36}, // 8
-    {0x06, 0x49, 0x49, 0x29, 0x1E}, // 9
-    {0x00, 0x36, 0x36, 0x00, 0x00}, // :
-    {0x00, 0x56, 0x36, 0x00, 0x00}, // ;
-    {0x00, 0x08, 0x14, 0x22, 0x41}, // <
-    {0x14, 0x14, 0x14, 0x14, 0x14}, // =
-    {0x41, 0x22, 0x14, 0x08, 0x00}, // >
-    {0x02, 0x01, 0x51, 0x09, 0x06}, // ?
-    {0x32, 0x49, 0x79, 0x41, 0x3E}, // @
-    {0x7E, 0x11, 0x11, 0x11, 0x7E}, // A
-    {0x7F, 0x49, 0x49, 0x49, 0x36}, // B
-    {0x3E, 0x41, 0x41, 0x41, 0x22}, // C
-    {0x7F, 0x41, 0x41, 0x22, 0x1C}, // D
-    {0x7F, 0x49, 0x49, 0x49, 0x41}, // E
-    {0x7F, 0x09, 0x09, 0x01, 0x01}, // F
-    {0x3E, 0x41, 0x41, 0x51, 0x32}, // G
-    {0x7F, 0x08, 0x08, 0x08, 0x7F}, // H
-    {0x00, 0x41, 0x7F, 0x41, 0x00}, // I
-    {0x20, 0x40, 0x41, 0x3F, 0x01}, // J
-    {0x7F, 0x08, 0x14, 0x22, 0x41}, // K
-    {0x7F, 0x40, 0x40, 0x40, 0x40}, // L
-    {0x7F, 0x02, 0x04, 0x02, 0x7F}, // M
-    {0x7F, 0x04, 0x08, 0x10, 0x7F}, // N
-    {0x3E, 0x41, 0x41, 0x41, 0x3E}, // O
-    {0x7F, 0x09, 0x09, 0x09, 0x06}, // P
-    {0x3E, 0x41, 0x51, 0x21, 0x5E}, // Q
-    {0x7F, 0x09, 0x19, 0x29, 0x46}, // R
-    {0x46, 0x49, 0x49, 0x49, 0x31}, // S
-    {0x01, 0x01, 0x7F, 0x01, 0x01}, // T
-    {0x3F, 0x40, 0x40, 0x40, 0x3F}, // U
-    {0x1F, 0x20, 0x40, 0x20, 0x1F}, // V
-    {0x7F, 0x20, 0x18, 0x20, 0x7F}, // W
-    {0x63, 0x14, 0x08, 0x14, 0x63}, // X
-    {0x03, 0x04, 0x78, 0x04, 0x03}, // Y
-    {0x61, 0x51, 0x49, 0x45, 0x43}, // Z
-    {0x00, 0x00, 0x7F, 0x41, 0x41}, // [
-    {0x02, 0x04, 0x08, 0x10, 0x20}, // backslash
-    {0x41, 0x41, 0x7F, 0x00, 0x00}, // ]
-    {0x04, 0x02, 0x01, 0x02, 0x04}, // ^
-    {0x40, 0x40, 0x40, 0x40, 0x40}, // _
-    {0x00, 0x01, 0x02, 0x04, 0x00}, // `
-    {0x20, 0x54, 0x54, 0x54, 0x78}, // a
-    {0x7F, 0x48, 0x44, 0x44, 0x38}, // b
-    {0x38, 0x44, 0x44, 0x44, 0x20}, // c
-    {0x38, 0x44, 0x44, 0x48, 0x7F}, // d
-    {0x38, 0x54, 0x54, 0x54, 0x18}, // e
-    {0x08, 0x7E, 0x09, 0x01, 0x02}, // f
-    {0x08, 0x14, 0x54, 0x54, 0x3C}, // g
-    {0x7F, 0x08, 0x04, 0x04, 0x78}, // h
-    {0x00, 0x44, 0x7D, 0x40, 0x00}, // i
-    {0x20, 0x40, 0x44, 0x3D, 0x00}, // j
-    {0x00, 0x7F, 0x10, 0x28, 0x44}, // k
-    {0x00, 0x41, 0x7F, 0x40, 0x00}, // l
-    {0x7C, 0x04, 0x18, 0x04, 0x78}, // m
-    {0x7C, 0x08, 0x04, 0x04, 0x78}, // n
-    {0x38, 0x44, 0x44, 0x44, 0x38}, // o
-    {0x7C, 0x14, 0x14, 0x14, 0x08}, // p
-    {0x08, 0x14, 0x14, 0x18, 0x7C}, // q
-    {0x7C, 0x08, 0x04, 0x04, 0x08}, // r
-    {0x48, 0x54, 0x54, 0x54, 0x20}, // s
-    {0x04, 0x3F, 0x44, 0x40, 0x20}, // t
-    {0x3C, 0x40, 0x40, 0x20, 0x7C}, // u
-    {0x1C, 0x20, 0x40, 0x20, 0x1C}, // v
-    {0x3C, 0x40, 0x30, 0x40, 0x3C}, // w
-    {0x44, 0x28, 0x10, 0x28, 0x44}, // x
-    {0x0C, 0x50, 0x50, 0x50, 0x3C}, // y
-    {0x44, 0x64, 0x54, 0x4C, 0x44}, // z
-};
+static const char *TAG = "INVENTORY_SCANNER";
 
-/* ================= OLED FRAME BUFFER ================= */
+/* ================= DISPLAY STATE ================= */
 
-static uint8_t oled_buffer[128 * 8];
+// True while the display task is taking screens: set when it is created,
+// cleared if the panel then fails to initialize
+static volatile bool oled_ready = false;
 
 /* ================= WIFI EVENT GROUP ================= */
 
 static EventGroupHandle_t s_wifi_event_group = NULL;
 #define WIFI_CONNECTED_BIT BIT0
 #define WIFI_FAIL_BIT      BIT1
+#define NET_WARMUP_BIT     BIT2
+#define NET_FILTER_SYNC_BIT BIT3   // Server reported a newer barcode filter
+#define WIFI_ROAMING_BIT   BIT4    // Planned roam under way; scans wait for it
+
+static int s_retry_num = 0;         // Failed attempts since the last stable link
+
+/* ================= WIFI FAST RECONNECT STATE ================= */
 
-static int s_retry_num = 0;
+// BSSID and channel of the last AP we associated with. A connect aimed at
+// them skips the all-channel scan; if that AP does not answer, the next
+// attempt scans normally.
+typedef struct {
+    char ssid[33];
+    uint8_t bssid[6];
+    uint8_t channel;
+} wifi_ap_cache_t;
+
+static wifi_ap_cache_t wifi_ap_cache;
+static bool wifi_ap_cache_valid = false;
+static bool wifi_targeted = false;          // Current attempt is aimed at the cached AP
+static bool wifi_link_up = false;           // Associated since the last disconnect
+static int64_t wifi_up_since_us = 0;        // When wifi_link_up was last set
+static esp_timer_handle_t wifi_retry_timer = NULL;
+static int64_t wifi_down_since_us = 0;      // 0 while connected
+static wifi_ap_cache_t wifi_target;         // AP the current attempt is aimed at
+
+/* ================= WIFI ROAMING STATE ================= */
+
+static esp_timer_handle_t roam_timer = NULL;
+static wifi_ap_cache_t roam_target;         // Chosen by a roam scan, used by the next connect
+static bool roam_target_valid = false;
+static bool roam_scan_active = false;
+static uint8_t roam_from_bssid[6];
+static int64_t roam_started_us = 0;         // 0 when no roam is in progress
+static wifi_ap_record_t roam_scan_records[ROAM_SCAN_MAX_APS];
 
 /* ================= BARCODE BUFFER & SYNC ================= */
 
 static char barcode_buf[BARCODE_MAX_LEN];
 static int barcode_len = 0;
 
+// Completed barcodes from the HID callback to api_task. Scans made before
+// the network is up wait here instead of being dropped.
+static QueueHandle_t scan_queue = NULL;
 static char api_barcode[BARCODE_MAX_LEN];
-static SemaphoreHandle_t api_semaphore = NULL;
+static volatile bool network_settled = false;  // api_task is past its boot wait
+
+/* ================= BOOT TIMING ================= */
+
+// Milestones since power-on, each logged the first time it is reached. The
+// full list is logged again once the first scan is accepted.
+typedef enum {
+    BOOT_APP_MAIN,
+    BOOT_USB_HOST_READY,
+    BOOT_DISPLAY_READY,
+    BOOT_WIFI_STARTED,
+    BOOT_SCANNER_ATTACHED,
+    BOOT_WIFI_CONNECTED,
+    BOOT_FIRST_SCAN,
+    BOOT_FIRST_SCAN_ACCEPTED,
+    BOOT_STAGE_COUNT,
+} boot_stage_t;
+
+static const char *const boot_stage_names[BOOT_STAGE_COUNT] = {
+    [BOOT_APP_MAIN] = "app_main",
+    [BOOT_USB_HOST_READY] = "USB host ready",
+    [BOOT_DISPLAY_READY] = "display ready",
+    [BOOT_WIFI_STARTED] = "Wi-Fi started",
+    [BOOT_SCANNER_ATTACHED] = "scanner attached",
+    [BOOT_WIFI_CONNECTED] = "Wi-Fi connected",
+    [BOOT_FIRST_SCAN] = "first scan",
+    [BOOT_FIRST_SCAN_ACCEPTED] = "first scan accepted",
+};
+
+static int64_t boot_stage_us[BOOT_STAGE_COUNT];
 
 /* ================= HTTP RESPONSE BUFFER ================= */
 
 static char http_response[HTTP_RESPONSE_MAX];
 static int http_response_len = 0;
 
+// Barcode filter version from the last API response's headers
+static bool http_filter_seen = false;
+static uint32_t http_filter_epoch = 0;
+static uint32_t http_filter_version = 0;
+
+/* ================= API CONNECTION CACHE ================= */
+
+// One keep-alive client is shared by the warm-up task and api_task, so the
+// TLS session opened right after GOT_IP is the one the first scan reuses.
+static esp_http_client_handle_t api_client = NULL;
+static SemaphoreHandle_t api_client_mutex = NULL;
+static volatile bool api_client_stale = false;
+static volatile int64_t api_client_used_us = 0;    // Last request on api_client
+
+// Only tracks when the host was last looked up; lwIP keeps the address
+typedef struct {
+    bool valid;
+    int64_t resolved_at_us;
+} dns_cache_t;
+
+static dns_cache_t dns_cache = {0};
+
 /* ================= SCAN RESULT STRUCTURE ================= */
 
 typedef struct {
@@ -226,6 +260,7 @@ typedef struct {
     char category[32];
     int quantity;
     int new_stock;
+    int original_stock;
     int quantity_changed;
     int requested_quantity;
     bool was_partial_deduction;
@@ -234,637 +269,1398 @@ typedef struct {
     char stock_health[16];  // "healthy", "low", or "out_of_stock"
 } scan_result_t;
 
-/* ================= LED CONTROL ================= */
+/* ================= ITEM CACHE ================= */
 
-static void led_init(void)
+typedef struct {
+    bool valid;
+    uint32_t hash;
+    uint32_t last_used;
+    char barcode[BARCODE_MAX_LEN];
+    char name[64];
+    char category[32];
+    int stock;
+    int original_stock;
+    char stock_health[16];
+} item_cache_entry_t;
+
+static item_cache_entry_t item_cache[ITEM_CACHE_SIZE];
+static uint32_t item_cache_clock = 0;
+
+/* ================= ITEM CATALOG ================= */
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t format;
+    uint16_t record_size;
+    uint32_t epoch;
+    uint32_t version;
+    uint32_t count;
+    uint32_t base_version;
+    uint8_t reserved[8];
+} catalog_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t hash;
+    int32_t quantity;
+    int32_t original_stock;
+    uint8_t flags;
+    uint8_t pad[3];
+    char barcode[36];
+    char name[52];
+    char category[24];
+} catalog_record_t;
+
+_Static_assert(sizeof(catalog_header_t) == 32, "catalog header must match server/catalog.ts");
+_Static_assert(sizeof(catalog_record_t) == 128, "catalog record must match server/catalog.ts");
+
+static const esp_partition_t *catalog_partition = NULL;
+static esp_partition_mmap_handle_t catalog_mmap_handle;
+static const catalog_header_t *catalog_image = NULL;  // NULL while unmapped or invalid
+static uint32_t catalog_epoch = 0;
+static uint32_t catalog_version = 0;
+static catalog_record_t catalog_overlay[CATALOG_OVERLAY_SIZE];
+static int catalog_overlay_count = 0;
+static SemaphoreHandle_t catalog_mutex = NULL;
+
+/* ================= BARCODE FILTER STATE ================= */
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint32_t epoch;
+    uint32_t version;
+    uint32_t bit_count;
+    uint8_t hash_count;
+    uint8_t pad[3];
+} barcode_filter_header_t;
+
+_Static_assert(sizeof(barcode_filter_header_t) == 20, "filter header must match server/catalog.ts");
+
+// Guarded by catalog_mutex
+static uint8_t *barcode_filter_bits = NULL;
+static uint32_t barcode_filter_bit_count = 0;
+static uint32_t barcode_filter_hashes = 0;
+static uint32_t barcode_filter_epoch = 0;
+static uint32_t barcode_filter_version = 0;
+static int64_t barcode_filter_checked_us = 0;
+
+// Last stock change the server applied; used to project the next one
+static char last_scan_action[16] = "";
+static int last_scan_quantity = 0;
+
+/* ================= ITEM CACHE FUNCTIONS ================= */
+
+static uint32_t barcode_hash(const char *barcode)
 {
-    ESP_LOGI(TAG, "Initializing stock health LEDs...");
-    
-    gpio_config_t io_conf = {
-        .intr_type = GPIO_INTR_DISABLE,
-        .mode = GPIO_MODE_OUTPUT,
-        .pin_bit_mask = (1ULL << LED_GREEN_GPIO) | (1ULL << LED_YELLOW_GPIO) | (1ULL << LED_RED_GPIO),
-        .pull_down_en = GPIO_PULLDOWN_DISABLE,
-        .pull_up_en = GPIO_PULLUP_DISABLE,
-    };
-    gpio_config(&io_conf);
-    
-    gpio_set_level(LED_GREEN_GPIO, 0);
-    gpio_set_level(LED_YELLOW_GPIO, 0);
-    gpio_set_level(LED_RED_GPIO, 0);
-    
-    ESP_LOGI(TAG, "LEDs initialized (Green=%d, Yellow=%d, Red=%d)", LED_GREEN_GPIO, LED_YELLOW_GPIO, LED_RED_GPIO);
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    while (*barcode) {
+        hash ^= (uint8_t)*barcode++;
+        hash *= 16777619u;
+    }
+    return hash;
 }
 
-static void led_set_stock_health(const char *health)
+static item_cache_entry_t *item_cache_lookup(const char *barcode)
 {
-    gpio_set_level(LED_GREEN_GPIO, 0);
-    gpio_set_level(LED_YELLOW_GPIO, 0);
-    gpio_set_level(LED_RED_GPIO, 0);
-    
-    if (strcmp(health, "healthy") == 0) {
-        gpio_set_level(LED_GREEN_GPIO, 1);
-        ESP_LOGI(TAG, "LED: GREEN (Healthy stock)");
-    } else if (strcmp(health, "low") == 0) {
-        gpio_set_level(LED_YELLOW_GPIO, 1);
-        ESP_LOGI(TAG, "LED: YELLOW (Low stock)");
-    } else if (strcmp(health, "out_of_stock") == 0) {
-        gpio_set_level(LED_RED_GPIO, 1);
-        ESP_LOGI(TAG, "LED: RED (Out of stock)");
+    uint32_t hash = barcode_hash(barcode);
+
+    for (int i = 0; i < ITEM_CACHE_SIZE; i++) {
+        item_cache_entry_t *entry = &item_cache[i];
+        if (entry->valid && entry->hash == hash && strcmp(entry->barcode, barcode) == 0) {
+            entry->last_used = ++item_cache_clock;
+            return entry;
+        }
     }
+    return NULL;
 }
 
-static void led_all_off(void)
+static void item_cache_store(const char *barcode, const scan_result_t *result)
 {
-    gpio_set_level(LED_GREEN_GPIO, 0);
-    gpio_set_level(LED_YELLOW_GPIO, 0);
-    gpio_set_level(LED_RED_GPIO, 0);
-}
+    item_cache_entry_t *entry = item_cache_lookup(barcode);
+
+    if (entry == NULL) {
+        // Take a free slot, otherwise evict the least recently used one
+        entry = &item_cache[0];
+        for (int i = 0; i < ITEM_CACHE_SIZE; i++) {
+            if (!item_cache[i].valid) {
+                entry = &item_cache[i];
+                break;
+            }
+            if (item_cache[i].last_used < entry->last_used) {
+                entry = &item_cache[i];
+            }
+        }
+        entry->valid = true;
+        entry->hash = barcode_hash(barcode);
+        strncpy(entry->barcode, barcode, sizeof(entry->barcode) - 1);
+        entry->barcode[sizeof(entry->barcode) - 1] = '\0';
+        entry->last_used = ++item_cache_clock;
+    }
 
-/* ================= I2C CLEANUP ================= */
+    strncpy(entry->name, result->name, sizeof(entry->name) - 1);
+    entry->name[sizeof(entry->name) - 1] = '\0';
+    strncpy(entry->category, result->category, sizeof(entry->category) - 1);
+    entry->category[sizeof(entry->category) - 1] = '\0';
+    strncpy(entry->stock_health, result->stock_health, sizeof(entry->stock_health) - 1);
+    entry->stock_health[sizeof(entry->stock_health) - 1] = '\0';
+    entry->stock = result->new_stock;
+    if (result->original_stock > 0) {
+        entry->original_stock = result->original_stock;
+    } else if (entry->original_stock <= 0) {
+        entry->original_stock = result->new_stock;
+    }
+}
 
-static void i2c_cleanup(void)
+static void item_cache_remove(const char *barcode)
 {
-    if (oled_dev_handle != NULL) {
-        i2c_master_bus_rm_device(oled_dev_handle);
-        oled_dev_handle = NULL;
+    item_cache_entry_t *entry = item_cache_lookup(barcode);
+    if (entry != NULL) {
+        entry->valid = false;
     }
-    if (i2c_bus_handle != NULL) {
-        i2c_del_master_bus(i2c_bus_handle);
-        i2c_bus_handle = NULL;
-    }
-    oled_ready = false;
 }
 
-/* ================= I2C INIT (NEW API for ESP-IDF v5.x) ================= */
+// Same thresholds as getStockHealth() on the server
+static const char *stock_health_for(int stock, int original_stock)
+{
+    if (stock <= 0) return "out_of_stock";
+    int percentage = original_stock > 0 ? (stock * 100) / original_stock : 100;
+    return percentage >= 31 ? "healthy" : "low";
+}
 
-static esp_err_t i2c_master_init(void)
+static int projected_stock(int stock)
 {
-    ESP_LOGI(TAG, "Initializing I2C master bus...");
-    
-    i2c_cleanup();
-    
-    i2c_master_bus_config_t bus_config = {
-        .clk_source = I2C_CLK_SRC_DEFAULT,
-        .i2c_port = I2C_NUM_0,
-        .scl_io_num = I2C_MASTER_SCL_IO,
-        .sda_io_num = I2C_MASTER_SDA_IO,
-        .glitch_ignore_cnt = 7,
-        .flags.enable_internal_pullup = true,
-    };
-    
-    esp_err_t err = i2c_new_master_bus(&bus_config, &i2c_bus_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to create I2C master bus: %s", esp_err_to_name(err));
-        i2c_bus_handle = NULL;
-        return err;
+    if (strcmp(last_scan_action, "DEDUCT") == 0) {
+        int projected = stock - last_scan_quantity;
+        return projected < 0 ? 0 : projected;
     }
-    
-    i2c_device_config_t dev_config = {
-        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
-        .device_address = OLED_ADDR,
-        .scl_speed_hz = I2C_MASTER_FREQ_HZ,
-    };
-    
-    err = i2c_master_bus_add_device(i2c_bus_handle, &dev_config, &oled_dev_handle);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to add OLED device: %s", esp_err_to_name(err));
-        i2c_del_master_bus(i2c_bus_handle);
-        i2c_bus_handle = NULL;
-        oled_dev_handle = NULL;
-        return err;
+    if (strcmp(last_scan_action, "ADD") == 0) {
+        return stock + last_scan_quantity;
     }
-    
-    ESP_LOGI(TAG, "I2C master initialized successfully");
-    return ESP_OK;
+    return stock;
 }
 
-/* ================= OLED COMMANDS (NEW API) ================= */
+/* ================= BOOT TIMING FUNCTIONS ================= */
 
-static esp_err_t oled_send_cmd(uint8_t cmd)
+static void boot_stage_mark(boot_stage_t stage)
 {
-    uint8_t data[2] = {0x00, cmd};
-    return i2c_master_transmit(oled_dev_handle, data, 2, 100);
+    if (boot_stage_us[stage] != 0) {
+        return;
+    }
+    boot_stage_us[stage] = esp_timer_get_time();
+    ESP_LOGI(TAG, "Boot: %s at %lld ms", boot_stage_names[stage],
+             (long long)(boot_stage_us[stage] / 1000));
+
+    if (stage == BOOT_FIRST_SCAN_ACCEPTED) {
+        ESP_LOGI(TAG, "Boot timeline (ms since power-on):");
+        for (int i = 0; i < BOOT_STAGE_COUNT; i++) {
+            if (boot_stage_us[i] != 0) {
+                ESP_LOGI(TAG, "  %-20s %6lld", boot_stage_names[i], (long long)(boot_stage_us[i] / 1000));
+            }
+        }
+    }
 }
 
-static esp_err_t oled_send_data(uint8_t *data, size_t len)
+/* ================= LED CONTROL ================= */
+
+// The LED colour is the stock health; the pattern says how sure we are
+// (solid: server confirmed, breathe: offline catalog data)
+static void led_set_stock_health(const char *health, led_pattern_t pattern)
 {
-    uint8_t *buffer = malloc(len + 1);
-    if (!buffer) return ESP_ERR_NO_MEM;
-    buffer[0] = 0x40;
-    memcpy(buffer + 1, data, len);
-    esp_err_t err = i2c_master_transmit(oled_dev_handle, buffer, len + 1, 100);
-    free(buffer);
-    return err;
+    if (strcmp(health, "healthy") == 0) {
+        status_led_show(LED_GREEN, pattern);
+        ESP_LOGI(TAG, "LED: GREEN (Healthy stock)");
+    } else if (strcmp(health, "low") == 0) {
+        status_led_show(LED_YELLOW, pattern);
+        ESP_LOGI(TAG, "LED: YELLOW (Low stock)");
+    } else if (strcmp(health, "out_of_stock") == 0) {
+        status_led_show(LED_RED, pattern);
+        ESP_LOGI(TAG, "LED: RED (Out of stock)");
+    } else {
+        status_led_off();
+    }
 }
 
 /* ================= OLED INIT ================= */
 
 static esp_err_t oled_init(void)
 {
-    esp_err_t err;
-    
-    oled_ready = false;
-    
     ESP_LOGI(TAG, "Initializing OLED display...");
-    
-    vTaskDelay(pdMS_TO_TICKS(100));
-    
-    err = oled_send_cmd(OLED_CMD_DISPLAY_OFF);
+
+    esp_err_t err = panel_init();
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "OLED not responding - check wiring!");
-        i2c_cleanup();
         return err;
     }
-    
-    err = oled_send_cmd(OLED_CMD_SET_MUX_RATIO);
-    if (err != ESP_OK) goto cleanup_fail;
-    err = oled_send_cmd(0x3F);
-    if (err != ESP_OK) goto cleanup_fail;
-    
-    err = oled_send_cmd(OLED_CMD_SET_DISPLAY_OFFSET);
-    if (err != ESP_OK) goto cleanup_fail;
-    err = oled_send_cmd(0x00);
-    if (err != ESP_OK) goto cleanup_fail;
-    
-    oled_send_cmd(OLED_CMD_SET_START_LINE | 0x00);
-    oled_send_cmd(OLED_CMD_SET_SEG_REMAP);
-    oled_send_cmd(OLED_CMD_SET_COM_SCAN_DEC);
-    
-    oled_send_cmd(OLED_CMD_SET_COM_PINS);
-    oled_send_cmd(0x12);
-    
-    oled_send_cmd(OLED_CMD_SET_CONTRAST);
-    oled_send_cmd(0xCF);
-    
-    oled_send_cmd(OLED_CMD_ENTIRE_DISPLAY_ON);
-    oled_send_cmd(OLED_CMD_SET_NORMAL_DISPLAY);
-    
-    oled_send_cmd(OLED_CMD_SET_OSC_FREQ);
-    oled_send_cmd(0x80);
-    
-    oled_send_cmd(OLED_CMD_SET_CHARGE_PUMP);
-    oled_send_cmd(0x14);
-    
-    oled_send_cmd(OLED_CMD_SET_MEMORY_MODE);
-    oled_send_cmd(0x00);
-    
-    err = oled_send_cmd(OLED_CMD_DISPLAY_ON);
-    if (err != ESP_OK) goto cleanup_fail;
-    
-    memset(oled_buffer, 0, sizeof(oled_buffer));
-    
-    oled_ready = true;
+
+    oled_reset();
+
     ESP_LOGI(TAG, "OLED initialized successfully");
     return ESP_OK;
+}
+
+/* ================= DISPLAY TASK ================= */
+
+// Screens are described, not drawn, by the producers; the display task owns
+// the panel and renders them. The queue holds a single slot that every
+// submit overwrites, so a screen superseded before it was drawn is skipped.
+
+static QueueHandle_t display_queue = NULL;
+
+static void display_task(void *arg)
+{
+    screen_desc_t desc;
+
+    // Panel bring-up happens here, alongside USB and Wi-Fi start; whatever
+    // screen is submitted meanwhile waits in the queue
+    if (oled_init() != ESP_OK) {
+        ESP_LOGW(TAG, "OLED init failed - continuing without display");
+        oled_ready = false;
+        vTaskDelete(NULL);
+        return;
+    }
+    boot_stage_mark(BOOT_DISPLAY_READY);
 
-cleanup_fail:
-    ESP_LOGE(TAG, "OLED init failed during command sequence");
-    i2c_cleanup();
-    return err;
+    while (1) {
+        // While a marquee runs, the receive timeout is its step timer
+        TickType_t wait = marquee_active() ? pdMS_TO_TICKS(MARQUEE_STEP_MS) : portMAX_DELAY;
+        if (xQueueReceive(display_queue, &desc, wait) != pdTRUE) {
+            if (marquee_active()) {
+                oled_begin_frame();
+                marquee_step();
+                oled_update();
+            }
+            continue;
+        }
+        oled_begin_frame();
+        uint32_t start = esp_cpu_get_cycle_count();
+        render_screen(&desc);
+        uint32_t render_cycles = esp_cpu_get_cycle_count() - start;
+        oled_update();
+        ESP_LOGD(TAG, "Screen %d rendered in %lu cycles", desc.screen, (unsigned long)render_cycles);
+    }
 }
 
-/* ================= OLED DISPLAY FUNCTIONS ================= */
+static void display_submit(const screen_desc_t *desc)
+{
+    if (display_queue != NULL) {
+        xQueueOverwrite(display_queue, desc);
+    }
+}
 
-static void oled_clear(void)
+static void screen_set_item(screen_desc_t *d, const char *name, const char *category, const char *stock_health)
 {
-    memset(oled_buffer, 0, sizeof(oled_buffer));
+    strncpy(d->name, name ? name : "", sizeof(d->name) - 1);
+    strncpy(d->category, category ? category : "", sizeof(d->category) - 1);
+    strncpy(d->stock_health, stock_health ? stock_health : "", sizeof(d->stock_health) - 1);
 }
 
-static void oled_update(void)
+static void display_startup(void)
 {
-    oled_send_cmd(OLED_CMD_SET_COL_ADDR);
-    oled_send_cmd(0);
-    oled_send_cmd(127);
-    
-    oled_send_cmd(OLED_CMD_SET_PAGE_ADDR);
-    oled_send_cmd(0);
-    oled_send_cmd(7);
-    
-    oled_send_data(oled_buffer, sizeof(oled_buffer));
+    screen_desc_t d = { .screen = SCREEN_STARTUP };
+    display_submit(&d);
 }
 
-static void oled_set_pixel(int x, int y, bool on)
+static void display_scanning(const char *barcode)
 {
-    if (x < 0 || x >= 128 || y < 0 || y >= 64) return;
-    
-    int page = y / 8;
-    int bit = y % 8;
-    int index = page * 128 + x;
-    
-    if (on) {
-        oled_buffer[index] |= (1 << bit);
-    } else {
-        oled_buffer[index] &= ~(1 << bit);
+    screen_desc_t d = { .screen = SCREEN_SCANNING };
+    strncpy(d.text, barcode, sizeof(d.text) - 1);
+    display_submit(&d);
+}
+
+static void display_not_found(const char *barcode)
+{
+    screen_desc_t d = { .screen = SCREEN_NOT_FOUND };
+    strncpy(d.text, barcode, sizeof(d.text) - 1);
+    display_submit(&d);
+}
+
+static void display_out_of_stock(const char *name, const char *category)
+{
+    screen_desc_t d = { .screen = SCREEN_OUT_OF_STOCK };
+    screen_set_item(&d, name, category, "out_of_stock");
+    display_submit(&d);
+}
+
+static void display_success(const char *name, const char *category, int new_stock)
+{
+    screen_desc_t d = { .screen = SCREEN_SUCCESS, .stock = new_stock };
+    screen_set_item(&d, name, category, NULL);
+    display_submit(&d);
+}
+
+static void display_added(const char *name, const char *category, int quantity_added, int new_stock, const char *stock_health)
+{
+    screen_desc_t d = { .screen = SCREEN_ADDED, .quantity = quantity_added, .stock = new_stock };
+    screen_set_item(&d, name, category, stock_health);
+    display_submit(&d);
+}
+
+static void display_deducted(const char *name, const char *category, int quantity_deducted, int new_stock, const char *stock_health)
+{
+    screen_desc_t d = { .screen = SCREEN_DEDUCTED, .quantity = quantity_deducted, .stock = new_stock };
+    screen_set_item(&d, name, category, stock_health);
+    display_submit(&d);
+}
+
+static void display_view_details(const char *name, const char *category, int current_stock, int original_stock, const char *stock_health)
+{
+    screen_desc_t d = { .screen = SCREEN_VIEW_DETAILS, .quantity = current_stock, .stock = original_stock };
+    screen_set_item(&d, name, category, stock_health);
+    display_submit(&d);
+}
+
+static void display_partial_deduction(const char *name, const char *category, int quantity_deducted, int requested, int new_stock, const char *stock_health)
+{
+    screen_desc_t d = {
+        .screen = SCREEN_PARTIAL_DEDUCTION,
+        .quantity = quantity_deducted,
+        .stock = new_stock,
+        .requested = requested,
+    };
+    screen_set_item(&d, name, category, stock_health);
+    display_submit(&d);
+}
+
+static void display_error(const char *message)
+{
+    screen_desc_t d = { .screen = SCREEN_ERROR };
+    strncpy(d.text, message, sizeof(d.text) - 1);
+    display_submit(&d);
+}
+
+static void display_wifi_connecting(void)
+{
+    screen_desc_t d = { .screen = SCREEN_WIFI_CONNECTING };
+    display_submit(&d);
+}
+
+static void display_wifi_connected(void)
+{
+    screen_desc_t d = { .screen = SCREEN_WIFI_CONNECTED };
+    display_submit(&d);
+}
+
+static void display_cached_item(const char *name, const char *category, int projected_stock, const char *stock_health)
+{
+    screen_desc_t d = { .screen = SCREEN_CACHED_ITEM, .stock = projected_stock };
+    screen_set_item(&d, name, category, stock_health);
+    display_submit(&d);
+}
+
+static void display_offline_details(const char *name, const char *category, int current_stock, int original_stock, const char *stock_health)
+{
+    screen_desc_t d = { .screen = SCREEN_OFFLINE_DETAILS, .quantity = current_stock, .stock = original_stock };
+    screen_set_item(&d, name, category, stock_health);
+    display_submit(&d);
+}
+
+static void display_no_oled(void)
+{
+    ESP_LOGW(TAG, "OLED display not available");
+}
+
+/* ================= WIFI FAST RECONNECT ================= */
+
+static void wifi_ap_cache_load(void)
+{
+    nvs_handle_t nvs;
+    if (nvs_open(WIFI_CACHE_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return;
+    }
+    size_t len = sizeof(wifi_ap_cache);
+    esp_err_t err = nvs_get_blob(nvs, WIFI_CACHE_KEY, &wifi_ap_cache, &len);
+    nvs_close(nvs);
+
+    // An entry saved for another network is useless after a reflash
+    wifi_ap_cache_valid = err == ESP_OK && len == sizeof(wifi_ap_cache) &&
+                          strncmp(wifi_ap_cache.ssid, WIFI_SSID, sizeof(wifi_ap_cache.ssid)) == 0;
+    if (wifi_ap_cache_valid) {
+        ESP_LOGI(TAG, "Last AP " MACSTR " on channel %d",
+                 MAC2STR(wifi_ap_cache.bssid), wifi_ap_cache.channel);
     }
 }
 
-static void oled_draw_char(int x, int y, char c)
+// Only writes when the AP changed, so steady reconnects cost no flash wear
+static void wifi_ap_cache_store(const uint8_t bssid[6], uint8_t channel)
 {
-    if (c < 32 || c > 122) c = ' ';
-    int index = c - 32;
-    
-    for (int col = 0; col < 5; col++) {
-        uint8_t line = font5x7[index][col];
-        for (int row = 0; row < 7; row++) {
-            if (line & (1 << row)) {
-                oled_set_pixel(x + col, y + row, true);
-            }
+    if (wifi_ap_cache_valid && wifi_ap_cache.channel == channel &&
+        memcmp(wifi_ap_cache.bssid, bssid, sizeof(wifi_ap_cache.bssid)) == 0) {
+        return;
+    }
+
+    memset(&wifi_ap_cache, 0, sizeof(wifi_ap_cache));
+    strncpy(wifi_ap_cache.ssid, WIFI_SSID, sizeof(wifi_ap_cache.ssid) - 1);
+    memcpy(wifi_ap_cache.bssid, bssid, sizeof(wifi_ap_cache.bssid));
+    wifi_ap_cache.channel = channel;
+    wifi_ap_cache_valid = true;
+
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(WIFI_CACHE_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err == ESP_OK) {
+        err = nvs_set_blob(nvs, WIFI_CACHE_KEY, &wifi_ap_cache, sizeof(wifi_ap_cache));
+        if (err == ESP_OK) {
+            err = nvs_commit(nvs);
         }
+        nvs_close(nvs);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Could not save AP to NVS: %s", esp_err_to_name(err));
+    }
+}
+
+// Aims the next connect at one AP (one channel, one BSSID), or with NULL
+// at the strongest AP with our SSID
+static esp_err_t wifi_apply_config(const wifi_ap_cache_t *ap)
+{
+    wifi_config_t wifi_config = {
+        .sta = {
+            .ssid = WIFI_SSID,
+            .password = WIFI_PASSWORD,
+            .threshold.authmode = WIFI_AUTH_WPA2_PSK,
+            .scan_method = WIFI_ALL_CHANNEL_SCAN,
+            .sort_method = WIFI_CONNECT_AP_BY_SIGNAL,
+            // 802.11k neighbour reports, 802.11v BSS transition, 802.11r FT
+            .rm_enabled = 1,
+            .btm_enabled = 1,
+            .ft_enabled = 1,
+        },
+    };
+
+    wifi_targeted = ap != NULL;
+    if (wifi_targeted) {
+        wifi_target = *ap;
+        wifi_config.sta.scan_method = WIFI_FAST_SCAN;
+        wifi_config.sta.bssid_set = true;
+        memcpy(wifi_config.sta.bssid, ap->bssid, sizeof(wifi_config.sta.bssid));
+        wifi_config.sta.channel = ap->channel;
+    }
+    return esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
+}
+
+static void wifi_retry_timer_cb(void *arg)
+{
+    esp_wifi_connect();
+}
+
+static void wifi_schedule_retry(uint32_t delay_ms)
+{
+    if (delay_ms == 0) {
+        esp_wifi_connect();
+        return;
     }
+    esp_timer_stop(wifi_retry_timer);
+    esp_timer_start_once(wifi_retry_timer, (uint64_t)delay_ms * 1000);
+}
+
+/* ================= WIFI ROAMING ================= */
+
+// The driver reports WIFI_EVENT_STA_BSS_RSSI_LOW once per arming
+static void roam_arm(void)
+{
+    esp_wifi_set_rssi_threshold(ROAM_RSSI_THRESHOLD);
 }
 
-static void oled_draw_string(int x, int y, const char *str)
+static void roam_timer_cb(void *arg)
 {
-    while (*str) {
-        oled_draw_char(x, y, *str);
-        x += 6;
-        str++;
-        if (x >= 128) break;
+    if (roam_started_us != 0) {
+        ESP_LOGI(TAG, "Roam: no better AP, staying on " MACSTR, MAC2STR(roam_from_bssid));
+        roam_started_us = 0;
+    }
+    if (wifi_link_up) {
+        roam_arm();
     }
 }
 
-static void oled_draw_string_large(int x, int y, const char *str)
+static void roam_start(int32_t rssi)
 {
-    while (*str) {
-        if (x >= 128) break;
-        
-        if (*str >= 32 && *str <= 122) {
-            int index = *str - 32;
-            for (int col = 0; col < 5; col++) {
-                uint8_t line = font5x7[index][col];
-                for (int row = 0; row < 7; row++) {
-                    if (line & (1 << row)) {
-                        oled_set_pixel(x + col*2, y + row*2, true);
-                        oled_set_pixel(x + col*2 + 1, y + row*2, true);
-                        oled_set_pixel(x + col*2, y + row*2 + 1, true);
-                        oled_set_pixel(x + col*2 + 1, y + row*2 + 1, true);
-                    }
+    if (roam_started_us != 0 || roam_scan_active) {
+        return;
+    }
+    ESP_LOGI(TAG, "Roam: RSSI %ld dBm on " MACSTR ", looking for a better AP",
+             (long)rssi, MAC2STR(wifi_ap_cache.bssid));
+    memcpy(roam_from_bssid, wifi_ap_cache.bssid, sizeof(roam_from_bssid));
+    roam_started_us = esp_timer_get_time();
+
+    // Checked again after ROAM_RETRY_MS whatever happens here
+    esp_timer_stop(roam_timer);
+    esp_timer_start_once(roam_timer, (uint64_t)ROAM_RETRY_MS * 1000);
+
+    // An 802.11v AP answers with a transition request naming better
+    // neighbours and the supplicant moves there itself (using FT if offered)
+    if (esp_wnm_is_btm_supported_connection() &&
+        esp_wnm_send_bss_transition_mgmt_query(REASON_RSSI, NULL, 0) == 0) {
+        return;
+    }
+
+    wifi_scan_config_t scan_config = {
+        .ssid = (uint8_t *)WIFI_SSID,
+    };
+    if (esp_wifi_scan_start(&scan_config, false) == ESP_OK) {
+        roam_scan_active = true;
+    }
+}
+
+// Picks the strongest other AP from the roam scan; moving only pays off if
+// it beats the current one by ROAM_RSSI_HYSTERESIS
+static void roam_scan_done(void)
+{
+    roam_scan_active = false;
+
+    uint16_t count = ROAM_SCAN_MAX_APS;
+    wifi_ap_record_t current;
+    if (esp_wifi_scan_get_ap_records(&count, roam_scan_records) != ESP_OK ||
+        esp_wifi_sta_get_ap_info(&current) != ESP_OK) {
+        return;
+    }
+
+    const wifi_ap_record_t *best = NULL;
+    for (int i = 0; i < count; i++) {
+        if (memcmp(roam_scan_records[i].bssid, current.bssid, sizeof(current.bssid)) == 0) {
+            continue;
+        }
+        if (best == NULL || roam_scan_records[i].rssi > best->rssi) {
+            best = &roam_scan_records[i];
+        }
+    }
+    if (best == NULL || best->rssi < current.rssi + ROAM_RSSI_HYSTERESIS) {
+        return;
+    }
+
+    ESP_LOGI(TAG, "Roam: moving to " MACSTR " (%d dBm, current %d dBm)",
+             MAC2STR(best->bssid), best->rssi, current.rssi);
+    memset(&roam_target, 0, sizeof(roam_target));
+    strncpy(roam_target.ssid, WIFI_SSID, sizeof(roam_target.ssid) - 1);
+    memcpy(roam_target.bssid, best->bssid, sizeof(roam_target.bssid));
+    roam_target.channel = best->primary;
+    roam_target_valid = true;
+    xEventGroupSetBits(s_wifi_event_group, WIFI_ROAMING_BIT);
+    esp_wifi_disconnect();
+}
+
+/* ================= WIFI EVENT HANDLER ================= */
+
+static void wifi_event_handler(void* arg, esp_event_base_t event_base,
+                               int32_t event_id, void* event_data)
+{
+    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
+        esp_wifi_connect();
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
+        wifi_event_sta_connected_t *event = (wifi_event_sta_connected_t *) event_data;
+        wifi_link_up = true;
+        wifi_up_since_us = esp_timer_get_time();
+        if (roam_started_us != 0) {
+            ESP_LOGI(TAG, "Roam: " MACSTR " -> " MACSTR " in %lld ms",
+                     MAC2STR(roam_from_bssid), MAC2STR(event->bssid),
+                     (long long)((esp_timer_get_time() - roam_started_us) / 1000));
+            roam_started_us = 0;
+        }
+        wifi_ap_cache_store(event->bssid, event->channel);
+        roam_arm();
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_BSS_RSSI_LOW) {
+        wifi_event_bss_rssi_low_t *event = (wifi_event_bss_rssi_low_t *) event_data;
+        roam_start(event->rssi);
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_SCAN_DONE) {
+        if (roam_scan_active) {
+            roam_scan_done();
+        }
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
+        wifi_event_sta_disconnected_t *event = (wifi_event_sta_disconnected_t *) event_data;
+        bool was_up = wifi_link_up;
+        wifi_link_up = false;
+        bool planned = event->reason == WIFI_REASON_ROAMING || (was_up && roam_target_valid);
+        // An AP that associates and then drops us (MAC filter, DHCP failure)
+        // must not become a tight reconnect loop, so only a link that held
+        // gets the immediate reconnect; a short one backs off like a failure
+        bool held = was_up && (esp_timer_get_time() - wifi_up_since_us) >= (int64_t)WIFI_STABLE_MS * 1000;
+        if (held) {
+            s_retry_num = 0;
+        }
+
+        xEventGroupClearBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
+        if (planned) {
+            // Same network and IP after the roam, so the TLS session may
+            // well survive it; the warm-up after GOT_IP finds out
+            xEventGroupSetBits(s_wifi_event_group, WIFI_ROAMING_BIT);
+        } else {
+            // Any open TLS session died with the link; drop it on next use
+            xEventGroupClearBits(s_wifi_event_group, WIFI_ROAMING_BIT);
+            dns_cache.valid = false;
+            api_client_stale = true;
+        }
+
+        if (was_up) {
+            wifi_down_since_us = esp_timer_get_time();
+        }
+        if (event->reason == WIFI_REASON_ROAMING) {
+            // BSS transition under way; the supplicant reassociates by itself
+            return;
+        }
+
+        uint32_t delay_ms = 0;
+        if (was_up && roam_target_valid) {
+            roam_target_valid = false;
+            wifi_apply_config(&roam_target);
+        } else if (held) {
+            // Straight back to the AP we just lost, without scanning
+            ESP_LOGW(TAG, "WiFi link lost (reason %d)", event->reason);
+            wifi_apply_config(wifi_ap_cache_valid ? &wifi_ap_cache : NULL);
+        } else if (wifi_targeted && !was_up) {
+            ESP_LOGW(TAG, "AP " MACSTR " did not answer (reason %d), scanning",
+                     MAC2STR(wifi_target.bssid), event->reason);
+            wifi_apply_config(NULL);
+        } else {
+            if (was_up) {
+                ESP_LOGW(TAG, "WiFi link dropped after %lld ms (reason %d)",
+                         (long long)((esp_timer_get_time() - wifi_up_since_us) / 1000), event->reason);
+                if (wifi_targeted) {
+                    wifi_apply_config(NULL);
                 }
             }
+            s_retry_num++;
+            int shift = s_retry_num - 1 < 6 ? s_retry_num - 1 : 6;
+            delay_ms = WIFI_RETRY_BASE_MS << shift;
+            if (delay_ms > WIFI_RETRY_MAX_MS) {
+                delay_ms = WIFI_RETRY_MAX_MS;
+            }
+            if (s_retry_num == WIFI_MAXIMUM_RETRY) {
+                // Lets boot go on offline; retries carry on in the background
+                xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);
+                ESP_LOGE(TAG, "WiFi connection failed, still retrying");
+            }
+            ESP_LOGI(TAG, "Retrying WiFi in %lu ms (attempt %d)",
+                     (unsigned long)delay_ms, s_retry_num + 1);
         }
-        x += 12;
-        str++;
+        wifi_schedule_retry(delay_ms);
+    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
+        ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
+        ESP_LOGI(TAG, "Connected! IP: " IPSTR, IP2STR(&event->ip_info.ip));
+        if (wifi_down_since_us != 0) {
+            ESP_LOGI(TAG, "Link restored in %lld ms (%s)",
+                     (long long)((esp_timer_get_time() - wifi_down_since_us) / 1000),
+                     wifi_targeted ? "cached AP" : "scan");
+            wifi_down_since_us = 0;
+        }
+        boot_stage_mark(BOOT_WIFI_CONNECTED);
+        xEventGroupClearBits(s_wifi_event_group, WIFI_FAIL_BIT | WIFI_ROAMING_BIT);
+        xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT | NET_WARMUP_BIT);
     }
 }
 
-/* ================= DISPLAY SCREENS ================= */
+/* ================= WIFI INIT ================= */
 
-static void display_startup(void)
+// Starts association and returns; WIFI_CONNECTED_BIT or WIFI_FAIL_BIT
+// reports the outcome. Needs NVS for the cached AP.
+static void wifi_init_sta(void)
 {
-    oled_clear();
-    oled_draw_string_large(10, 10, "INVENTORY");
-    oled_draw_string_large(15, 30, "SCANNER");
-    oled_draw_string(30, 55, "Ready to scan...");
-    oled_update();
+    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_ERROR_CHECK(esp_event_loop_create_default());
+    esp_netif_t *sta_netif = esp_netif_create_default_wifi_sta();
+
+    if (WIFI_STATIC_IP[0] != '\0') {
+        // No DHCP round trip at all; GOT_IP follows association directly
+        esp_netif_ip_info_t ip_info = {0};
+        ip_info.ip.addr = esp_ip4addr_aton(WIFI_STATIC_IP);
+        ip_info.netmask.addr = esp_ip4addr_aton(WIFI_STATIC_NETMASK);
+        ip_info.gw.addr = esp_ip4addr_aton(WIFI_STATIC_GW);
+        ESP_ERROR_CHECK(esp_netif_dhcpc_stop(sta_netif));
+        ESP_ERROR_CHECK(esp_netif_set_ip_info(sta_netif, &ip_info));
+
+        if (WIFI_STATIC_DNS[0] != '\0') {
+            esp_netif_dns_info_t dns = {0};
+            dns.ip.u_addr.ip4.addr = esp_ip4addr_aton(WIFI_STATIC_DNS);
+            dns.ip.type = ESP_IPADDR_TYPE_V4;
+            ESP_ERROR_CHECK(esp_netif_set_dns_info(sta_netif, ESP_NETIF_DNS_MAIN, &dns));
+        }
+        ESP_LOGI(TAG, "Static IP %s", WIFI_STATIC_IP);
+    }
+
+    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+    if (wifi_power_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Power save policy init failed - keeping the driver default");
+    }
+
+    const esp_timer_create_args_t retry_timer_args = {
+        .callback = wifi_retry_timer_cb,
+        .name = "wifi_retry",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&retry_timer_args, &wifi_retry_timer));
+
+    const esp_timer_create_args_t roam_timer_args = {
+        .callback = roam_timer_cb,
+        .name = "wifi_roam",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&roam_timer_args, &roam_timer));
+
+    esp_event_handler_instance_t instance_any_id;
+    esp_event_handler_instance_t instance_got_ip;
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT,
+                                                        ESP_EVENT_ANY_ID,
+                                                        &wifi_event_handler,
+                                                        NULL,
+                                                        &instance_any_id));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT,
+                                                        IP_EVENT_STA_GOT_IP,
+                                                        &wifi_event_handler,
+                                                        NULL,
+                                                        &instance_got_ip));
+
+    wifi_ap_cache_load();
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    ESP_ERROR_CHECK(wifi_apply_config(wifi_ap_cache_valid ? &wifi_ap_cache : NULL));
+    ESP_ERROR_CHECK(esp_wifi_start());
+    boot_stage_mark(BOOT_WIFI_STARTED);
+
+    if (oled_ready) {
+        display_wifi_connecting();
+    }
 }
 
-static void display_scanning(const char *barcode)
+/* ================= HTTP EVENT HANDLER ================= */
+
+static esp_err_t http_event_handler(esp_http_client_event_t *evt)
 {
-    oled_clear();
-    oled_draw_string_large(10, 5, "SCANNING");
-    oled_draw_string(10, 30, "Barcode:");
-    oled_draw_string(10, 42, barcode);
-    oled_draw_string(25, 55, "Please wait...");
-    oled_update();
+    switch(evt->event_id) {
+        case HTTP_EVENT_ON_DATA:
+            if (http_response_len + evt->data_len < HTTP_RESPONSE_MAX - 1) {
+                memcpy(http_response + http_response_len, evt->data, evt->data_len);
+                http_response_len += evt->data_len;
+                http_response[http_response_len] = '\0';
+            }
+            break;
+        case HTTP_EVENT_ON_HEADER:
+            if (strcasecmp(evt->header_key, "X-Catalog-Epoch") == 0) {
+                http_filter_epoch = strtoul(evt->header_value, NULL, 10);
+            } else if (strcasecmp(evt->header_key, "X-Barcode-Filter-Version") == 0) {
+                http_filter_version = strtoul(evt->header_value, NULL, 10);
+                http_filter_seen = true;
+            }
+            break;
+        default:
+            break;
+    }
+    return ESP_OK;
 }
 
-static void display_not_found(const char *barcode)
+/* ================= SIMPLE JSON PARSER ================= */
+
+static bool json_get_bool(const char *json, const char *key)
 {
-    oled_clear();
-    oled_draw_string_large(5, 0, "NOT FOUND");
-    oled_draw_string(5, 25, "Barcode:");
-    oled_draw_string(5, 37, barcode);
-    oled_draw_string(5, 52, "Not in database!");
-    oled_update();
+    char search[64];
+    snprintf(search, sizeof(search), "\"%s\":", key);
+    char *pos = strstr(json, search);
+    if (!pos) return false;
+    pos += strlen(search);
+    while (*pos == ' ') pos++;
+    return strncmp(pos, "true", 4) == 0;
 }
 
-static const char* get_status_text(const char *stock_health)
+static int json_get_int(const char *json, const char *key)
 {
-    if (stock_health == NULL || stock_health[0] == '\0' || strcmp(stock_health, "healthy") == 0) {
-        return "Healthy";
-    } else if (strcmp(stock_health, "low") == 0) {
-        return "Low";
-    } else if (strcmp(stock_health, "out_of_stock") == 0) {
-        return "Out of Stock";
-    } else {
-        return "Healthy";
-    }
+    char search[64];
+    snprintf(search, sizeof(search), "\"%s\":", key);
+    char *pos = strstr(json, search);
+    if (!pos) return 0;
+    pos += strlen(search);
+    while (*pos == ' ') pos++;
+    return atoi(pos);
 }
 
-static void display_out_of_stock(const char *name, const char *category)
+static void json_get_string(const char *json, const char *key, char *out, size_t max_len)
 {
-    oled_clear();
-    oled_draw_string_large(0, 0, "OUT OF STOCK");
-    
-    char name_line[22];
-    snprintf(name_line, sizeof(name_line), "%.21s", name);
-    oled_draw_string(0, 20, name_line);
-    
-    char cat_line[22];
-    snprintf(cat_line, sizeof(cat_line), "Cat: %.16s", category);
-    oled_draw_string(0, 32, cat_line);
+    out[0] = '\0';
+    char search[64];
+    snprintf(search, sizeof(search), "\"%s\":\"", key);
+    char *pos = strstr(json, search);
+    if (!pos) return;
+    pos += strlen(search);
     
-    oled_draw_string(0, 44, "Stock: 0");
-    oled_draw_string(0, 56, "Status: Out of Stock");
-    oled_update();
+    size_t i = 0;
+    while (*pos && *pos != '"' && i < max_len - 1) {
+        out[i++] = *pos++;
+    }
+    out[i] = '\0';
 }
 
-static void display_success(const char *name, const char *category, int new_stock)
+/* ================= API CONNECTION ================= */
+
+static void api_host_from_url(char *host, size_t max_len)
 {
-    oled_clear();
-    oled_draw_string_large(10, 0, "SCANNED!");
-    
-    char name_line[22];
-    snprintf(name_line, sizeof(name_line), "%.21s", name);
-    oled_draw_string(0, 20, name_line);
-    
-    char cat_line[22];
-    snprintf(cat_line, sizeof(cat_line), "Cat: %.16s", category);
-    oled_draw_string(0, 32, cat_line);
-    
-    char stock_line[22];
-    snprintf(stock_line, sizeof(stock_line), "New Stock: %d", new_stock);
-    oled_draw_string(0, 48, stock_line);
-    
-    oled_update();
+    const char *start = strstr(API_BASE_URL, "://");
+    start = start ? start + 3 : API_BASE_URL;
+
+    size_t i = 0;
+    while (start[i] && start[i] != '/' && start[i] != ':' && i < max_len - 1) {
+        host[i] = start[i];
+        i++;
+    }
+    host[i] = '\0';
 }
 
-static void display_added(const char *name, const char *category, int quantity_added, int new_stock, const char *stock_health)
+static void dns_resolve_api_host(void)
 {
-    oled_clear();
-    
-    char add_line[22];
-    snprintf(add_line, sizeof(add_line), "ADDED +%d", quantity_added);
-    oled_draw_string_large(5, 0, add_line);
-    
-    char name_line[22];
-    snprintf(name_line, sizeof(name_line), "%.21s", name);
-    oled_draw_string(0, 20, name_line);
-    
-    char cat_line[22];
-    snprintf(cat_line, sizeof(cat_line), "Cat: %.16s", category);
-    oled_draw_string(0, 32, cat_line);
-    
-    char stock_line[22];
-    snprintf(stock_line, sizeof(stock_line), "New Stock: %d", new_stock);
-    oled_draw_string(0, 44, stock_line);
-    
-    char status_line[22];
-    snprintf(status_line, sizeof(status_line), "Status: %s", get_status_text(stock_health));
-    oled_draw_string(0, 56, status_line);
-    
-    oled_update();
+    if (dns_cache.valid &&
+        (esp_timer_get_time() - dns_cache.resolved_at_us) < (int64_t)DNS_CACHE_TTL_MS * 1000) {
+        return;
+    }
+
+    char host[128];
+    api_host_from_url(host, sizeof(host));
+
+    struct addrinfo hints = {
+        .ai_family = AF_INET,
+        .ai_socktype = SOCK_STREAM,
+    };
+    struct addrinfo *res = NULL;
+
+    int64_t start = esp_timer_get_time();
+    int err = getaddrinfo(host, NULL, &hints, &res);
+    if (err != 0 || res == NULL) {
+        ESP_LOGW(TAG, "DNS lookup for %s failed (%d)", host, err);
+        dns_cache.valid = false;
+        return;
+    }
+
+    // lwIP keeps the answer in its own resolver table, so the lookup
+    // esp_http_client does on connect is served locally from here on
+    dns_cache.resolved_at_us = esp_timer_get_time();
+    dns_cache.valid = true;
+    ESP_LOGI(TAG, "Resolved %s -> %s in %lld ms", host,
+             inet_ntoa(((struct sockaddr_in *)res->ai_addr)->sin_addr),
+             (long long)((dns_cache.resolved_at_us - start) / 1000));
+    freeaddrinfo(res);
 }
 
-static void display_deducted(const char *name, const char *category, int quantity_deducted, int new_stock, const char *stock_health)
+// Caller must hold api_client_mutex
+static esp_http_client_handle_t api_client_acquire(void)
 {
-    oled_clear();
-    
-    char deduct_line[22];
-    snprintf(deduct_line, sizeof(deduct_line), "DEDUCTED -%d", quantity_deducted);
-    oled_draw_string_large(0, 0, deduct_line);
-    
-    char name_line[22];
-    snprintf(name_line, sizeof(name_line), "%.21s", name);
-    oled_draw_string(0, 20, name_line);
-    
-    char cat_line[22];
-    snprintf(cat_line, sizeof(cat_line), "Cat: %.16s", category);
-    oled_draw_string(0, 32, cat_line);
-    
-    char stock_line[22];
-    snprintf(stock_line, sizeof(stock_line), "New Stock: %d", new_stock);
-    oled_draw_string(0, 44, stock_line);
-    
-    char status_line[22];
-    snprintf(status_line, sizeof(status_line), "Status: %s", get_status_text(stock_health));
-    oled_draw_string(0, 56, status_line);
-    
-    oled_update();
+    if (api_client != NULL && api_client_stale) {
+        esp_http_client_cleanup(api_client);
+        api_client = NULL;
+    }
+    api_client_stale = false;
+
+    if (api_client == NULL) {
+        esp_http_client_config_t config = {
+            .url = API_BASE_URL API_SCAN_ENDPOINT,
+            .method = HTTP_METHOD_POST,
+            .timeout_ms = HTTP_TIMEOUT_MS,
+            .crt_bundle_attach = esp_crt_bundle_attach,
+            .transport_type = HTTP_TRANSPORT_OVER_SSL,
+            .buffer_size = 2048,
+            .buffer_size_tx = 1024,
+            .event_handler = http_event_handler,
+            .keep_alive_enable = true,
+        };
+        api_client = esp_http_client_init(&config);
+    }
+    return api_client;
 }
 
-static void display_view_details(const char *name, const char *category, int current_stock, int original_stock, const char *stock_health)
+// Caller must hold api_client_mutex
+static void api_client_discard(void)
 {
-    oled_clear();
-    oled_draw_string_large(20, 0, "DETAILS");
-    
-    char name_line[22];
-    snprintf(name_line, sizeof(name_line), "%.21s", name);
-    oled_draw_string(0, 18, name_line);
-    
-    char cat_line[22];
-    snprintf(cat_line, sizeof(cat_line), "Cat: %.16s", category);
-    oled_draw_string(0, 30, cat_line);
-    
-    char stock_line[22];
-    snprintf(stock_line, sizeof(stock_line), "Stock: %d/%d", current_stock, original_stock);
-    oled_draw_string(0, 42, stock_line);
-    
-    char status_line[22];
-    snprintf(status_line, sizeof(status_line), "Status: %s", get_status_text(stock_health));
-    oled_draw_string(0, 54, status_line);
-    
-    oled_update();
+    if (api_client != NULL) {
+        esp_http_client_cleanup(api_client);
+        api_client = NULL;
+    }
 }
 
-static void display_partial_deduction(const char *name, const char *category, int quantity_deducted, int requested, int new_stock, const char *stock_health)
+/* ================= ITEM CATALOG FUNCTIONS ================= */
+
+// Caller must hold catalog_mutex
+static void catalog_unmap(void)
 {
-    oled_clear();
-    
-    char deduct_line[22];
-    snprintf(deduct_line, sizeof(deduct_line), "PARTIAL -%d", quantity_deducted);
-    oled_draw_string_large(0, 0, deduct_line);
-    
-    char name_line[22];
-    snprintf(name_line, sizeof(name_line), "%.21s", name);
-    oled_draw_string(0, 18, name_line);
-    
-    char info_line[22];
-    snprintf(info_line, sizeof(info_line), "Req:%d Got:%d", requested, quantity_deducted);
-    oled_draw_string(0, 30, info_line);
-    
-    char stock_line[22];
-    snprintf(stock_line, sizeof(stock_line), "New Stock: %d", new_stock);
-    oled_draw_string(0, 42, stock_line);
-    
-    char status_line[22];
-    snprintf(status_line, sizeof(status_line), "Status: %s", get_status_text(stock_health));
-    oled_draw_string(0, 54, status_line);
-    
-    oled_update();
+    if (catalog_image != NULL) {
+        esp_partition_munmap(catalog_mmap_handle);
+        catalog_image = NULL;
+    }
 }
 
-static void display_error(const char *message)
-{
-    oled_clear();
-    oled_draw_string_large(20, 10, "ERROR");
-    oled_draw_string(5, 40, message);
-    oled_update();
-}
+// Caller must hold catalog_mutex
+static void catalog_map(void)
+{
+    catalog_unmap();
+    catalog_overlay_count = 0;
+
+    if (catalog_partition == NULL) {
+        catalog_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                     CATALOG_PARTITION_LABEL);
+        if (catalog_partition == NULL) {
+            ESP_LOGW(TAG, "No '%s' partition - catalog disabled", CATALOG_PARTITION_LABEL);
+            return;
+        }
+    }
+
+    const void *ptr = NULL;
+    esp_err_t err = esp_partition_mmap(catalog_partition, 0, catalog_partition->size,
+                                       ESP_PARTITION_MMAP_DATA, &ptr, &catalog_mmap_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Catalog mmap failed: %s", esp_err_to_name(err));
+        return;
+    }
+
+    const catalog_header_t *header = ptr;
+    size_t max_records = (catalog_partition->size - sizeof(catalog_header_t)) / sizeof(catalog_record_t);
+    if (header->magic != CATALOG_IMAGE_MAGIC || header->format != CATALOG_FORMAT ||
+        header->record_size != sizeof(catalog_record_t) || header->count > max_records) {
+        ESP_LOGW(TAG, "Catalog partition holds no valid image");
+        esp_partition_munmap(catalog_mmap_handle);
+        catalog_epoch = 0;
+        catalog_version = 0;
+        return;
+    }
+
+    catalog_image = header;
+    catalog_epoch = header->epoch;
+    catalog_version = header->version;
+    ESP_LOGI(TAG, "Catalog mapped: %lu items, version %lu",
+             (unsigned long)header->count, (unsigned long)header->version);
+}
+
+static bool catalog_lookup(const char *barcode, catalog_record_t *out)
+{
+    bool found = false;
+    uint32_t hash = barcode_hash(barcode);
+
+    xSemaphoreTake(catalog_mutex, portMAX_DELAY);
+
+    // Delta records are newer than the flash image
+    for (int i = 0; i < catalog_overlay_count; i++) {
+        const catalog_record_t *rec = &catalog_overlay[i];
+        if (rec->hash == hash && strncmp(rec->barcode, barcode, sizeof(rec->barcode)) == 0) {
+            found = !(rec->flags & CATALOG_FLAG_DELETED);
+            if (found) {
+                *out = *rec;
+            }
+            xSemaphoreGive(catalog_mutex);
+            return found;
+        }
+    }
+
+    if (catalog_image != NULL) {
+        const catalog_record_t *records = (const catalog_record_t *)(catalog_image + 1);
+
+        // Lower bound on hash, then walk the (rare) collisions
+        uint32_t lo = 0, hi = catalog_image->count;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            if (records[mid].hash < hash) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        for (uint32_t i = lo; i < catalog_image->count && records[i].hash == hash; i++) {
+            if (strncmp(records[i].barcode, barcode, sizeof(records[i].barcode)) == 0) {
+                *out = records[i];
+                found = true;
+                break;
+            }
+        }
+    }
+
+    xSemaphoreGive(catalog_mutex);
+    return found;
+}
+
+// Caller must hold catalog_mutex. Returns false when the overlay is full.
+static bool catalog_overlay_put(const catalog_record_t *rec)
+{
+    for (int i = 0; i < catalog_overlay_count; i++) {
+        if (catalog_overlay[i].hash == rec->hash &&
+            strncmp(catalog_overlay[i].barcode, rec->barcode, sizeof(rec->barcode)) == 0) {
+            catalog_overlay[i] = *rec;
+            return true;
+        }
+    }
+    if (catalog_overlay_count >= CATALOG_OVERLAY_SIZE) {
+        return false;
+    }
+    catalog_overlay[catalog_overlay_count++] = *rec;
+    return true;
+}
+
+static bool http_read_full(esp_http_client_handle_t client, void *buf, int len)
+{
+    int got = 0;
+    while (got < len) {
+        int n = esp_http_client_read(client, (char *)buf + got, len - got);
+        if (n <= 0) {
+            return false;
+        }
+        got += n;
+    }
+    return true;
+}
+
+static esp_http_client_handle_t catalog_http_open(const char *url, int *status, int64_t *length)
+{
+    esp_http_client_config_t config = {
+        .url = url,
+        .method = HTTP_METHOD_GET,
+        .timeout_ms = HTTP_TIMEOUT_MS,
+        .crt_bundle_attach = esp_crt_bundle_attach,
+        .transport_type = HTTP_TRANSPORT_OVER_SSL,
+        .buffer_size = 2048,
+    };
+
+    esp_http_client_handle_t client = esp_http_client_init(&config);
+    if (client == NULL) {
+        return NULL;
+    }
+
+    esp_err_t err = esp_http_client_open(client, 0);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Catalog request failed: %s", esp_err_to_name(err));
+        esp_http_client_cleanup(client);
+        return NULL;
+    }
+
+    *length = esp_http_client_fetch_headers(client);
+    *status = esp_http_client_get_status_code(client);
+    return client;
+}
+
+static bool catalog_download_image(void)
+{
+    int status = 0;
+    int64_t length = 0;
+    esp_http_client_handle_t client = catalog_http_open(API_BASE_URL API_CATALOG_ENDPOINT, &status, &length);
+    if (client == NULL) {
+        return false;
+    }
+
+    bool ok = false;
+    int64_t start = esp_timer_get_time();
+
+    if (status != 200 || length < (int64_t)sizeof(catalog_header_t) ||
+        catalog_partition == NULL || length > catalog_partition->size) {
+        ESP_LOGW(TAG, "Catalog image rejected (HTTP %d, %lld bytes)", status, (long long)length);
+        goto done;
+    }
+
+    // Lookups miss (and fall back to the server) while the image is rewritten
+    xSemaphoreTake(catalog_mutex, portMAX_DELAY);
+    catalog_unmap();
+    catalog_overlay_count = 0;
+    xSemaphoreGive(catalog_mutex);
+
+    size_t erase_len = ((size_t)length + 4095) & ~(size_t)4095;
+    esp_err_t err = esp_partition_erase_range(catalog_partition, 0, erase_len);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Catalog erase failed: %s", esp_err_to_name(err));
+        goto done;
+    }
+
+    // The header goes in last: until then the erased header sector has no
+    // magic, so a cut-off download or a power loss leaves no valid image
+    catalog_header_t header;
+    if (!http_read_full(client, &header, sizeof(header))) {
+        ESP_LOGE(TAG, "Catalog download truncated at 0 bytes");
+        goto done;
+    }
+
+    static char chunk[1024];
+    size_t offset = sizeof(header);
+    while (offset < (size_t)length) {
+        int want = (size_t)length - offset < sizeof(chunk) ? (int)((size_t)length - offset) : (int)sizeof(chunk);
+        if (!http_read_full(client, chunk, want)) {
+            ESP_LOGE(TAG, "Catalog download truncated at %u bytes", (unsigned)offset);
+            goto done;
+        }
+        err = esp_partition_write(catalog_partition, offset, chunk, want);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Catalog write failed: %s", esp_err_to_name(err));
+            goto done;
+        }
+        offset += want;
+    }
+
+    err = esp_partition_write(catalog_partition, 0, &header, sizeof(header));
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Catalog header write failed: %s", esp_err_to_name(err));
+        goto done;
+    }
+    ok = true;
+
+done:
+    esp_http_client_cleanup(client);
+
+    xSemaphoreTake(catalog_mutex, portMAX_DELAY);
+    if (ok) {
+        catalog_map();
+        ok = catalog_image != NULL;
+    } else if (catalog_image == NULL) {
+        // The old image is gone; the next sync must fetch a whole one
+        // rather than a delta from its version
+        catalog_epoch = 0;
+        catalog_version = 0;
+    }
+    xSemaphoreGive(catalog_mutex);
+
+    if (ok) {
+        ESP_LOGI(TAG, "Catalog image (%lld bytes) stored in %lld ms",
+                 (long long)length, (long long)((esp_timer_get_time() - start) / 1000));
+    }
+    return ok;
+}
+
+static void catalog_sync(void)
+{
+    if (catalog_partition == NULL) {
+        return;
+    }
+
+    if (catalog_image == NULL) {
+        catalog_download_image();
+        return;
+    }
+
+    char url[256];
+    snprintf(url, sizeof(url), "%s%s?epoch=%lu&since=%lu", API_BASE_URL, API_CATALOG_DELTA_ENDPOINT,
+             (unsigned long)catalog_epoch, (unsigned long)catalog_version);
+
+    int status = 0;
+    int64_t length = 0;
+    esp_http_client_handle_t client = catalog_http_open(url, &status, &length);
+    if (client == NULL) {
+        return;
+    }
+
+    bool need_image = false;
+    catalog_header_t header;
+
+    if (status == 410) {
+        need_image = true;
+    } else if (status != 200 || !http_read_full(client, &header, sizeof(header)) ||
+               header.magic != CATALOG_DELTA_MAGIC || header.record_size != sizeof(catalog_record_t)) {
+        ESP_LOGW(TAG, "Catalog delta rejected (HTTP %d)", status);
+    } else {
+        bool complete = true;
+        for (uint32_t i = 0; i < header.count; i++) {
+            catalog_record_t rec;
+            if (!http_read_full(client, &rec, sizeof(rec))) {
+                complete = false;
+                break;
+            }
+            xSemaphoreTake(catalog_mutex, portMAX_DELAY);
+            bool stored = catalog_overlay_put(&rec);
+            xSemaphoreGive(catalog_mutex);
+            if (!stored) {
+                need_image = true;
+                break;
+            }
+        }
+        if (complete && !need_image) {
+            catalog_version = header.version;
+            if (header.count > 0) {
+                ESP_LOGI(TAG, "Catalog delta applied: %lu changes, version %lu",
+                         (unsigned long)header.count, (unsigned long)catalog_version);
+            }
+        }
+    }
 
-static void display_wifi_connecting(void)
-{
-    oled_clear();
-    oled_draw_string_large(5, 15, "CONNECTING");
-    oled_draw_string(25, 40, "to WiFi...");
-    oled_update();
-}
+    esp_http_client_cleanup(client);
 
-static void display_wifi_connected(void)
-{
-    oled_clear();
-    oled_draw_string_large(10, 15, "CONNECTED");
-    oled_draw_string(30, 45, "WiFi OK!");
-    oled_update();
+    if (need_image) {
+        catalog_download_image();
+    }
 }
 
-static void display_no_oled(void)
+/* ================= BARCODE FILTER ================= */
+
+static uint32_t mix32(uint32_t h)
 {
-    ESP_LOGW(TAG, "OLED display not available");
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    h *= 0xc2b2ae35u;
+    h ^= h >> 16;
+    return h;
 }
 
-/* ================= WIFI EVENT HANDLER ================= */
-
-static void wifi_event_handler(void* arg, esp_event_base_t event_base,
-                               int32_t event_id, void* event_data)
+// True only when the filter proves the barcode is not in the database.
+// An item created on the dashboard a moment ago is missing from an older
+// filter, so a miss is only trusted within BARCODE_FILTER_TRUST_MS of the
+// last time the server confirmed the filter's version. Every scan and
+// keep-alive response confirms it, so while the API connection is kept
+// open the window does not lapse; otherwise the server decides.
+static bool barcode_filter_rejects(const char *barcode)
 {
-    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
-        esp_wifi_connect();
-    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
-        if (s_retry_num < WIFI_MAXIMUM_RETRY) {
-            esp_wifi_connect();
-            s_retry_num++;
-            ESP_LOGI(TAG, "Retrying WiFi... (%d/%d)", s_retry_num, WIFI_MAXIMUM_RETRY);
-        } else {
-            xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);
-            ESP_LOGE(TAG, "WiFi connection failed");
+    bool miss = false;
+    bool fresh = false;
+
+    xSemaphoreTake(catalog_mutex, portMAX_DELAY);
+    if (barcode_filter_bits != NULL) {
+        uint32_t h1 = barcode_hash(barcode);
+        uint32_t h2 = mix32(h1) | 1;
+        for (uint32_t j = 0; j < barcode_filter_hashes; j++) {
+            uint32_t bit = (uint32_t)(((uint64_t)h1 + (uint64_t)j * h2) % barcode_filter_bit_count);
+            if (!(barcode_filter_bits[bit >> 3] & (1 << (bit & 7)))) {
+                miss = true;
+                break;
+            }
         }
-    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
-        ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
-        ESP_LOGI(TAG, "Connected! IP: " IPSTR, IP2STR(&event->ip_info.ip));
-        s_retry_num = 0;
-        xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
+        fresh = (esp_timer_get_time() - barcode_filter_checked_us) < (int64_t)BARCODE_FILTER_TRUST_MS * 1000;
     }
-}
+    xSemaphoreGive(catalog_mutex);
 
-/* ================= WIFI INIT ================= */
+    return miss && fresh;
+}
 
-static void wifi_init_sta(void)
+// Caller holds api_client_mutex, after a request on api_client. A matching
+// version renews trust in the filter; a newer one withdraws it until the
+// warm-up task has fetched the new filter.
+static void barcode_filter_check_version(void)
 {
-    s_wifi_event_group = xEventGroupCreate();
-
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
-    esp_netif_create_default_wifi_sta();
+    if (!http_filter_seen) {
+        return;
+    }
 
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+    xSemaphoreTake(catalog_mutex, portMAX_DELAY);
+    bool current = barcode_filter_bits != NULL && http_filter_epoch == barcode_filter_epoch &&
+                   http_filter_version == barcode_filter_version;
+    barcode_filter_checked_us = current ? esp_timer_get_time() : 0;
+    xSemaphoreGive(catalog_mutex);
 
-    esp_event_handler_instance_t instance_any_id;
-    esp_event_handler_instance_t instance_got_ip;
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(WIFI_EVENT,
-                                                        ESP_EVENT_ANY_ID,
-                                                        &wifi_event_handler,
-                                                        NULL,
-                                                        &instance_any_id));
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(IP_EVENT,
-                                                        IP_EVENT_STA_GOT_IP,
-                                                        &wifi_event_handler,
-                                                        NULL,
-                                                        &instance_got_ip));
+    if (!current) {
+        xEventGroupSetBits(s_wifi_event_group, NET_FILTER_SYNC_BIT);
+    }
+}
 
-    wifi_config_t wifi_config = {
-        .sta = {
-            .ssid = WIFI_SSID,
-            .password = WIFI_PASSWORD,
-            .threshold.authmode = WIFI_AUTH_WPA2_PSK,
-        },
-    };
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
-    ESP_ERROR_CHECK(esp_wifi_start());
+static void barcode_filter_sync(void)
+{
+    char url[256];
+    snprintf(url, sizeof(url), "%s%s?epoch=%lu&version=%lu", API_BASE_URL, API_BARCODE_FILTER_ENDPOINT,
+             (unsigned long)barcode_filter_epoch, (unsigned long)barcode_filter_version);
 
-    if (oled_ready) {
-        display_wifi_connecting();
+    int status = 0;
+    int64_t length = 0;
+    esp_http_client_handle_t client = catalog_http_open(url, &status, &length);
+    if (client == NULL) {
+        return;
     }
 
-    EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group,
-            WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
-            pdFALSE,
-            pdFALSE,
-            portMAX_DELAY);
+    barcode_filter_header_t header;
 
-    if (bits & WIFI_CONNECTED_BIT) {
-        ESP_LOGI(TAG, "WiFi connected successfully");
-        if (oled_ready) {
-            display_wifi_connected();
-            vTaskDelay(pdMS_TO_TICKS(1500));
-        }
-    } else if (bits & WIFI_FAIL_BIT) {
-        ESP_LOGE(TAG, "WiFi connection failed");
-        if (oled_ready) {
-            display_error("WiFi Failed!");
+    if (status == 304) {
+        xSemaphoreTake(catalog_mutex, portMAX_DELAY);
+        barcode_filter_checked_us = esp_timer_get_time();
+        xSemaphoreGive(catalog_mutex);
+    } else if (status != 200 || !http_read_full(client, &header, sizeof(header)) ||
+               header.magic != BARCODE_FILTER_MAGIC || header.bit_count == 0 || header.bit_count % 8 != 0 ||
+               header.bit_count / 8 > BARCODE_FILTER_MAX_BYTES || header.hash_count == 0) {
+        ESP_LOGW(TAG, "Barcode filter rejected (HTTP %d)", status);
+    } else {
+        uint8_t *bits = malloc(header.bit_count / 8);
+        if (bits == NULL) {
+            ESP_LOGE(TAG, "No memory for barcode filter (%lu bytes)", (unsigned long)(header.bit_count / 8));
+        } else if (!http_read_full(client, bits, header.bit_count / 8)) {
+            ESP_LOGW(TAG, "Barcode filter download truncated");
+            free(bits);
+        } else {
+            xSemaphoreTake(catalog_mutex, portMAX_DELAY);
+            uint8_t *old = barcode_filter_bits;
+            barcode_filter_bits = bits;
+            barcode_filter_bit_count = header.bit_count;
+            barcode_filter_hashes = header.hash_count;
+            barcode_filter_epoch = header.epoch;
+            barcode_filter_version = header.version;
+            barcode_filter_checked_us = esp_timer_get_time();
+            xSemaphoreGive(catalog_mutex);
+            free(old);
+            ESP_LOGI(TAG, "Barcode filter updated: %lu bits, version %lu",
+                     (unsigned long)header.bit_count, (unsigned long)header.version);
         }
     }
+
+    esp_http_client_cleanup(client);
 }
 
-/* ================= HTTP EVENT HANDLER ================= */
+/* ================= NETWORK WARM-UP TASK ================= */
 
-static esp_err_t http_event_handler(esp_http_client_event_t *evt)
+// Opens the shared API connection with a health check, or with keepalive
+// set, pings an already open one so it is still there for the next scan
+static void api_connection_warm_up(bool keepalive)
 {
-    switch(evt->event_id) {
-        case HTTP_EVENT_ON_DATA:
-            if (http_response_len + evt->data_len < HTTP_RESPONSE_MAX - 1) {
-                memcpy(http_response + http_response_len, evt->data, evt->data_len);
-                http_response_len += evt->data_len;
-                http_response[http_response_len] = '\0';
+    // A scan already in flight warms the connection itself
+    if (xSemaphoreTake(api_client_mutex, 0) != pdTRUE) {
+        return;
+    }
+
+    int64_t start = esp_timer_get_time();
+    esp_http_client_handle_t client = api_client_acquire();
+    if (client != NULL) {
+        http_response_len = 0;
+        http_filter_seen = false;
+        esp_http_client_set_url(client, API_BASE_URL API_HEALTH_ENDPOINT);
+        esp_http_client_set_method(client, HTTP_METHOD_GET);
+        // The client still points at the last scan's body, which lived on
+        // send_scan_request's stack
+        esp_http_client_set_post_field(client, NULL, 0);
+        esp_http_client_delete_header(client, "Content-Type");
+
+        esp_err_t err = esp_http_client_perform(client);
+        if (err == ESP_OK) {
+            api_client_used_us = esp_timer_get_time();
+            barcode_filter_check_version();
+            if (!keepalive) {
+                ESP_LOGI(TAG, "API connection warmed up in %lld ms (HTTP %d)",
+                         (long long)((api_client_used_us - start) / 1000),
+                         esp_http_client_get_status_code(client));
             }
-            break;
-        default:
-            break;
+        } else {
+            ESP_LOGW(TAG, "API warm-up failed: %s", esp_err_to_name(err));
+            api_client_discard();
+        }
     }
-    return ESP_OK;
+    xSemaphoreGive(api_client_mutex);
 }
 
-/* ================= SIMPLE JSON PARSER ================= */
-
-static bool json_get_bool(const char *json, const char *key)
+static void net_warmup_task(void *arg)
 {
-    char search[64];
-    snprintf(search, sizeof(search), "\"%s\":", key);
-    char *pos = strstr(json, search);
-    if (!pos) return false;
-    pos += strlen(search);
-    while (*pos == ' ') pos++;
-    return strncmp(pos, "true", 4) == 0;
-}
+    ESP_LOGI(TAG, "Network warm-up task started");
 
-static int json_get_int(const char *json, const char *key)
-{
-    char search[64];
-    snprintf(search, sizeof(search), "\"%s\":", key);
-    char *pos = strstr(json, search);
-    if (!pos) return 0;
-    pos += strlen(search);
-    while (*pos == ' ') pos++;
-    return atoi(pos);
-}
+    int64_t last_sync_us = 0;
+    int64_t last_ping_us = 0;
 
-static void json_get_string(const char *json, const char *key, char *out, size_t max_len)
-{
-    out[0] = '\0';
-    char search[64];
-    snprintf(search, sizeof(search), "\"%s\":\"", key);
-    char *pos = strstr(json, search);
-    if (!pos) return;
-    pos += strlen(search);
-    
-    size_t i = 0;
-    while (*pos && *pos != '"' && i < max_len - 1) {
-        out[i++] = *pos++;
+    while (1) {
+        // Wake when the connection is due a ping, so the filter's version is
+        // confirmed again before BARCODE_FILTER_TRUST_MS runs out
+        int64_t active_us = api_client_used_us > last_ping_us ? api_client_used_us : last_ping_us;
+        int64_t idle_ms = (esp_timer_get_time() - active_us) / 1000;
+        int64_t wait_ms = API_KEEPALIVE_MS - idle_ms;
+        if (wait_ms < 100) {
+            wait_ms = 100;
+        } else if (wait_ms > API_KEEPALIVE_MS) {
+            wait_ms = API_KEEPALIVE_MS;
+        }
+        EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group, NET_WARMUP_BIT | NET_FILTER_SYNC_BIT,
+                                               pdTRUE, pdFALSE, pdMS_TO_TICKS(wait_ms));
+
+        int64_t now = esp_timer_get_time();
+        if (!(xEventGroupGetBits(s_wifi_event_group) & WIFI_CONNECTED_BIT)) {
+            last_ping_us = now;
+            continue;
+        }
+
+        if (bits & NET_WARMUP_BIT) {
+            dns_resolve_api_host();
+            api_connection_warm_up(false);
+        } else if (now - active_us >= (int64_t)API_KEEPALIVE_MS * 1000) {
+            api_connection_warm_up(true);
+            last_ping_us = now;
+        }
+
+        if ((bits & NET_WARMUP_BIT) || now - last_sync_us >= (int64_t)CATALOG_SYNC_INTERVAL_MS * 1000) {
+            barcode_filter_sync();
+            catalog_sync();
+            last_sync_us = now;
+        } else if (bits & NET_FILTER_SYNC_BIT) {
+            // Only the filter; catalog deltas wait for the regular sync
+            barcode_filter_sync();
+        }
     }
-    out[i] = '\0';
 }
 
 /* ================= API SCAN REQUEST ================= */
@@ -880,49 +1676,71 @@ static scan_result_t send_scan_request(const char *barcode)
     }
     
     EventBits_t bits = xEventGroupGetBits(s_wifi_event_group);
+    if (!(bits & WIFI_CONNECTED_BIT) && (bits & WIFI_ROAMING_BIT)) {
+        // A planned roam is a few hundred ms; wait it out rather than
+        // reporting the scan as offline
+        ESP_LOGI(TAG, "Roaming - holding scan");
+        bits = xEventGroupWaitBits(s_wifi_event_group, WIFI_CONNECTED_BIT, pdFALSE, pdFALSE,
+                                   pdMS_TO_TICKS(ROAM_HOLD_MS));
+    }
     if (!(bits & WIFI_CONNECTED_BIT)) {
         ESP_LOGE(TAG, "WiFi not connected");
         strcpy(result.message, "WiFi error");
         return result;
     }
 
-    char url[256];
-    snprintf(url, sizeof(url), "%s%s", API_BASE_URL, API_SCAN_ENDPOINT);
-
-    char post_data[128];
-    snprintf(post_data, sizeof(post_data), "{\"barcode\":\"%s\"}", barcode);
+    // Sent again unchanged on a retry; the server answers a repeated scanId
+    // from its replay cache instead of applying the scan twice
+    char post_data[160];
+    snprintf(post_data, sizeof(post_data), "{\"barcode\":\"%s\",\"scanId\":\"%08lx%08lx\"}",
+             barcode, (unsigned long)esp_random(), (unsigned long)esp_random());
 
     ESP_LOGI(TAG, "Sending to API: %s", post_data);
 
-    http_response_len = 0;
-    memset(http_response, 0, sizeof(http_response));
+    xSemaphoreTake(api_client_mutex, portMAX_DELAY);
 
-    esp_http_client_config_t config = {
-        .url = url,
-        .method = HTTP_METHOD_POST,
-        .timeout_ms = 15000,
-        .crt_bundle_attach = esp_crt_bundle_attach,
-        .transport_type = HTTP_TRANSPORT_OVER_SSL,
-        .buffer_size = 2048,
-        .buffer_size_tx = 1024,
-        .event_handler = http_event_handler,
-    };
+    esp_err_t err = ESP_FAIL;
+    esp_http_client_handle_t client = NULL;
+    int64_t start = esp_timer_get_time();
+
+    // A kept-alive connection may have been closed by the server while idle;
+    // retry once on a fresh connection before reporting a network error.
+    // The scanId makes this safe even if the first attempt reached the server.
+    for (int attempt = 0; attempt < 2; attempt++) {
+        client = api_client_acquire();
+        if (client == NULL) {
+            break;
+        }
+
+        http_response_len = 0;
+        http_filter_seen = false;
+        memset(http_response, 0, sizeof(http_response));
+
+        esp_http_client_set_url(client, API_BASE_URL API_SCAN_ENDPOINT);
+        esp_http_client_set_method(client, HTTP_METHOD_POST);
+        esp_http_client_set_header(client, "Content-Type", "application/json");
+        esp_http_client_set_post_field(client, post_data, strlen(post_data));
+
+        err = esp_http_client_perform(client);
+        if (err == ESP_OK) {
+            api_client_used_us = esp_timer_get_time();
+            barcode_filter_check_version();
+            break;
+        }
+        ESP_LOGW(TAG, "HTTP attempt %d failed: %s", attempt + 1, esp_err_to_name(err));
+        api_client_discard();
+    }
 
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    
     if (client == NULL) {
         ESP_LOGE(TAG, "Failed to init HTTP client");
         strcpy(result.message, "HTTP error");
+        xSemaphoreGive(api_client_mutex);
         return result;
     }
-    
-    esp_http_client_set_header(client, "Content-Type", "application/json");
-    esp_http_client_set_post_field(client, post_data, strlen(post_data));
-
-    esp_err_t err = esp_http_client_perform(client);
 
     if (err == ESP_OK) {
         int status_code = esp_http_client_get_status_code(client);
+        wifi_power_record_latency(esp_timer_get_time() - start);
         ESP_LOGI(TAG, "HTTP Status: %d", status_code);
         ESP_LOGI(TAG, "Response: %s", http_response);
         
@@ -936,6 +1754,7 @@ static scan_result_t send_scan_request(const char *barcode)
             result.quantity_changed = json_get_int(http_response, "quantityChanged");
             result.requested_quantity = json_get_int(http_response, "requestedQuantity");
             result.was_partial_deduction = json_get_bool(http_response, "wasPartialDeduction");
+            result.original_stock = json_get_int(http_response, "originalStock");
             json_get_string(http_response, "name", result.name, sizeof(result.name));
             json_get_string(http_response, "category", result.category, sizeof(result.category));
             json_get_string(http_response, "action", result.action, sizeof(result.action));
@@ -965,7 +1784,7 @@ static scan_result_t send_scan_request(const char *barcode)
         strcpy(result.message, "Network error");
     }
 
-    esp_http_client_cleanup(client);
+    xSemaphoreGive(api_client_mutex);
     return result;
 }
 
@@ -974,36 +1793,129 @@ static scan_result_t send_scan_request(const char *barcode)
 static void api_task(void *arg)
 {
     ESP_LOGI(TAG, "API task started");
+
+    // Scans made during boot stay in scan_queue until Wi-Fi either connects
+    // or gives up; after that a lost link is handled per scan (offline path)
+    EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group, WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
+                                           pdFALSE, pdFALSE, portMAX_DELAY);
+    network_settled = true;
+
+    UBaseType_t waiting = uxQueueMessagesWaiting(scan_queue);
+    if (bits & WIFI_CONNECTED_BIT) {
+        ESP_LOGI(TAG, "WiFi connected successfully");
+        if (oled_ready && waiting == 0) {
+            display_wifi_connected();
+            // Back to the ready screen unless a scan replaces it first
+            if (xQueuePeek(scan_queue, api_barcode, pdMS_TO_TICKS(WIFI_CONNECTED_SCREEN_MS)) != pdTRUE) {
+                display_startup();
+            }
+        }
+    } else {
+        ESP_LOGE(TAG, "WiFi connection failed");
+        if (oled_ready && waiting == 0) {
+            display_error("WiFi Failed!");
+        }
+    }
+    if (waiting > 0) {
+        ESP_LOGI(TAG, "Sending %u scans made while the network came up", (unsigned)waiting);
+    }
     
     while (1) {
-        if (xSemaphoreTake(api_semaphore, portMAX_DELAY) == pdTRUE) {
+        if (xQueueReceive(scan_queue, api_barcode, portMAX_DELAY) == pdTRUE) {
             ESP_LOGI(TAG, "Processing barcode: %s", api_barcode);
+
+            bool accepted;
+            if (wifi_power_handle_barcode(api_barcode, &accepted)) {
+                status_led_show(accepted ? LED_GREEN : LED_RED, LED_PATTERN_DOUBLE_FLASH);
+                if (oled_ready && !accepted) {
+                    display_error("Bad setting");
+                }
+                memset(api_barcode, 0, sizeof(api_barcode));
+                continue;
+            }
             
-            led_all_off();
+            // Waiting on the server
+            status_led_show(LED_YELLOW, LED_PATTERN_BLINK);
+            
+            if (barcode_filter_rejects(api_barcode)) {
+                ESP_LOGI(TAG, "Barcode not in filter - skipping server request");
+                item_cache_remove(api_barcode);
+                status_led_show(LED_RED, LED_PATTERN_DOUBLE_FLASH);
+                if (oled_ready) {
+                    display_not_found(api_barcode);
+                }
+                memset(api_barcode, 0, sizeof(api_barcode));
+                continue;
+            }
             
-            if (oled_ready) {
+            // Repeat items render from the cache right away; the server
+            // response below overwrites the screen with the real numbers
+            item_cache_entry_t *cached = item_cache_lookup(api_barcode);
+            catalog_record_t catalog_rec;
+            bool in_catalog = catalog_lookup(api_barcode, &catalog_rec);
+            if (cached != NULL) {
+                int projected = projected_stock(cached->stock);
+                ESP_LOGI(TAG, "Cache hit: %s, projected stock: %d", cached->name, projected);
+                if (oled_ready) {
+                    display_cached_item(cached->name, cached->category, projected,
+                                        stock_health_for(projected, cached->original_stock));
+                }
+            } else if (in_catalog) {
+                int projected = projected_stock(catalog_rec.quantity);
+                ESP_LOGI(TAG, "Catalog hit: %s, projected stock: %d", catalog_rec.name, projected);
+                if (oled_ready) {
+                    display_cached_item(catalog_rec.name, catalog_rec.category, projected,
+                                        stock_health_for(projected, catalog_rec.original_stock));
+                }
+            } else if (oled_ready) {
                 display_scanning(api_barcode);
             }
             
             scan_result_t result = send_scan_request(api_barcode);
+            bool offline = !result.found &&
+                           (strcmp(result.message, "WiFi error") == 0 || strcmp(result.message, "Network error") == 0);
+            
+            if (result.found) {
+                boot_stage_mark(BOOT_FIRST_SCAN_ACCEPTED);
+                item_cache_store(api_barcode, &result);
+                strncpy(last_scan_action, result.action, sizeof(last_scan_action) - 1);
+                if (strcmp(result.action, "DEDUCT") == 0) {
+                    last_scan_quantity = result.requested_quantity;
+                } else if (strcmp(result.action, "ADD") == 0) {
+                    last_scan_quantity = result.quantity_changed;
+                } else {
+                    last_scan_quantity = 0;
+                }
+            } else if (strcmp(result.message, "Not found") == 0) {
+                item_cache_remove(api_barcode);
+            }
             
-            if (!result.found) {
+            if (offline && in_catalog) {
+                const char *health = stock_health_for(catalog_rec.quantity, catalog_rec.original_stock);
+                ESP_LOGI(TAG, "Offline: showing catalog details for %s", catalog_rec.name);
+                led_set_stock_health(health, LED_PATTERN_BREATHE);
+                if (oled_ready) {
+                    display_offline_details(catalog_rec.name, catalog_rec.category, catalog_rec.quantity,
+                                            catalog_rec.original_stock, health);
+                }
+            } else if (!result.found) {
                 ESP_LOGI(TAG, "Barcode not found in database");
-                led_set_stock_health("out_of_stock");
+                // A network failure blinks, a real miss double-flashes
+                status_led_show(LED_RED, offline ? LED_PATTERN_BLINK : LED_PATTERN_DOUBLE_FLASH);
                 if (oled_ready) {
                     display_not_found(api_barcode);
                 }
             } else if (!result.success && strcmp(result.action, "DEDUCT") == 0) {
                 ESP_LOGI(TAG, "Item out of stock: %s", result.name);
-                led_set_stock_health("out_of_stock");
+                led_set_stock_health("out_of_stock", LED_PATTERN_SOLID);
                 if (oled_ready) {
                     display_out_of_stock(result.name, result.category);
                 }
             } else {
                 if (result.stock_health[0] != '\0') {
-                    led_set_stock_health(result.stock_health);
+                    led_set_stock_health(result.stock_health, LED_PATTERN_SOLID);
                 } else {
-                    led_set_stock_health("healthy");
+                    led_set_stock_health("healthy", LED_PATTERN_SOLID);
                 }
                 
                 if (strcmp(result.action, "ADD") == 0) {
@@ -1045,22 +1957,6 @@ static void api_task(void *arg)
     }
 }
 
-/* ================= KEYCODE TO ASCII ================= */
-
-static char keycode_to_ascii(uint8_t keycode)
-{
-    if (keycode >= HID_KEY_A && keycode <= HID_KEY_Z) {
-        return 'A' + (keycode - HID_KEY_A);
-    }
-    if (keycode >= HID_KEY_1 && keycode <= HID_KEY_9) {
-        return '1' + (keycode - HID_KEY_1);
-    }
-    if (keycode == HID_KEY_0) return '0';
-    if (keycode == HID_KEY_MINUS) return '-';
-    if (keycode == HID_KEY_ENTER) return '\n';
-    return 0;
-}
-
 /* ================= KEYBOARD REPORT HANDLER ================= */
 
 static void handle_keyboard_report(const uint8_t *data, int length)
@@ -1068,7 +1964,7 @@ static void handle_keyboard_report(const uint8_t *data, int length)
     if (length < 8) return;
 
     uint8_t keycode = data[2];
-    char c = keycode_to_ascii(keycode);
+    char c = hid_keycode_to_ascii(keycode);
 
     if (!c) return;
 
@@ -1076,14 +1972,27 @@ static void handle_keyboard_report(const uint8_t *data, int length)
         barcode_buf[barcode_len] = '\0';
 
         if (barcode_len > 0) {
+            // Acknowledge the capture before anything else; the result
+            // pattern follows when the API task gets an answer
+            status_led_ack();
+            wifi_power_activity();
+            boot_stage_mark(BOOT_FIRST_SCAN);
+
             ESP_LOGI(TAG, "=====================================");
             ESP_LOGI(TAG, "Scanned barcode: %s", barcode_buf);
             ESP_LOGI(TAG, "=====================================");
             
-            strncpy(api_barcode, barcode_buf, BARCODE_MAX_LEN - 1);
-            api_barcode[BARCODE_MAX_LEN - 1] = '\0';
-            
-            xSemaphoreGive(api_semaphore);
+            if (xQueueSend(scan_queue, barcode_buf, 0) != pdTRUE) {
+                ESP_LOGW(TAG, "Scan queue full - dropping %s", barcode_buf);
+                status_led_show(LED_RED, LED_PATTERN_BLINK);
+            } else if (!network_settled) {
+                ESP_LOGI(TAG, "Network not up yet - scan queued (%u waiting)",
+                         (unsigned)uxQueueMessagesWaiting(scan_queue));
+                status_led_show(LED_YELLOW, LED_PATTERN_DOUBLE_FLASH);
+                if (oled_ready) {
+                    display_scanning(barcode_buf);
+                }
+            }
         }
 
         barcode_len = 0;
@@ -1134,6 +2043,7 @@ static void hid_device_event(
 
         ESP_LOGI(TAG, "HID device connected (%s)",
                  params.proto == HID_PROTOCOL_KEYBOARD ? "Keyboard" : "Other");
+        boot_stage_mark(BOOT_SCANNER_ATTACHED);
 
         const hid_host_device_config_t dev_cfg = {
             .callback = hid_interface_callback,
@@ -1162,9 +2072,7 @@ static void hid_device_event(
 static void usb_host_task(void *arg)
 {
     ESP_LOGI(TAG, "USB Host task starting...");
-    
-    vTaskDelay(pdMS_TO_TICKS(500));
-    
+
     usb_host_config_t host_cfg = {
         .skip_phy_setup = false,
         .intr_flags = ESP_INTR_FLAG_LEVEL1
@@ -1195,6 +2103,7 @@ static void usb_host_task(void *arg)
     }
 
     ESP_LOGI(TAG, "USB HID Host ready - connect your barcode scanner");
+    boot_stage_mark(BOOT_USB_HOST_READY);
 
     while (1) {
         uint32_t events;
@@ -1206,13 +2115,53 @@ static void usb_host_task(void *arg)
 
 void app_main(void)
 {
+    boot_stage_mark(BOOT_APP_MAIN);
+
     ESP_LOGI(TAG, "=========================================");
     ESP_LOGI(TAG, "  Inventory Management Scanner v2.2");
     ESP_LOGI(TAG, "  ESP32-S3 + USB Scanner + OLED + LEDs");
     ESP_LOGI(TAG, "  ESP-IDF v5.3.x Compatible");
     ESP_LOGI(TAG, "=========================================");
 
-    vTaskDelay(pdMS_TO_TICKS(100));
+    // Everything the tasks share exists before any of them starts
+    scan_queue = xQueueCreate(SCAN_QUEUE_LEN, BARCODE_MAX_LEN);
+    s_wifi_event_group = xEventGroupCreate();
+    api_client_mutex = xSemaphoreCreateMutex();
+    catalog_mutex = xSemaphoreCreateMutex();
+    display_queue = xQueueCreate(1, sizeof(screen_desc_t));
+    if (scan_queue == NULL || s_wifi_event_group == NULL || api_client_mutex == NULL ||
+        catalog_mutex == NULL || display_queue == NULL) {
+        ESP_LOGE(TAG, "Failed to create queues and locks!");
+        return;
+    }
+
+    // The scanner is the slowest thing to enumerate and needs nothing else,
+    // so it starts first; scans are queued until the network is up
+    BaseType_t xReturned = xTaskCreatePinnedToCore(
+        usb_host_task,
+        "usb_host",
+        USB_HOST_TASK_STACK_SIZE,
+        NULL,
+        5,
+        NULL,
+        0
+    );
+    if (xReturned != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create USB host task!");
+    }
+
+    // The panel initializes inside its own task
+    if (xTaskCreatePinnedToCore(display_task, "display", DISPLAY_TASK_STACK_SIZE,
+                                NULL, 3, NULL, 0) == pdPASS) {
+        oled_ready = true;
+        display_startup();
+    } else {
+        ESP_LOGE(TAG, "Failed to create display task!");
+    }
+
+    if (status_led_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Status LED init failed - continuing without LEDs");
+    }
 
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
@@ -1223,47 +2172,23 @@ void app_main(void)
     ESP_ERROR_CHECK(ret);
     ESP_LOGI(TAG, "NVS Flash initialized");
 
-    vTaskDelay(pdMS_TO_TICKS(100));
-
-    ret = i2c_master_init();
-    if (ret == ESP_OK) {
-        ret = oled_init();
-        if (ret == ESP_OK) {
-            display_startup();
-        } else {
-            ESP_LOGW(TAG, "OLED init failed - continuing without display");
-        }
-    } else {
-        ESP_LOGW(TAG, "I2C init failed - continuing without OLED");
-    }
-    
-    led_init();
-    
-    vTaskDelay(pdMS_TO_TICKS(500));
-
-    api_semaphore = xSemaphoreCreateBinary();
-    if (api_semaphore == NULL) {
-        ESP_LOGE(TAG, "Failed to create semaphore!");
-        return;
-    }
-
     wifi_init_sta();
 
-    vTaskDelay(pdMS_TO_TICKS(500));
+    xSemaphoreTake(catalog_mutex, portMAX_DELAY);
+    catalog_map();
+    xSemaphoreGive(catalog_mutex);
 
-    BaseType_t xReturned;
-    
     xReturned = xTaskCreatePinnedToCore(
-        usb_host_task,
-        "usb_host",
-        USB_HOST_TASK_STACK_SIZE,
+        net_warmup_task,
+        "net_warmup",
+        NET_WARMUP_TASK_STACK_SIZE,
         NULL,
-        5,
+        3,
         NULL,
-        0
+        1
     );
     if (xReturned != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create USB host task!");
+        ESP_LOGE(TAG, "Failed to create network warm-up task!");
     }
     
     xReturned = xTaskCreatePinnedToCore(
@@ -1279,10 +2204,6 @@ void app_main(void)
         ESP_LOGE(TAG, "Failed to create API task!");
     }
 
-    if (oled_ready) {
-        display_startup();
-    }
-
     ESP_LOGI(TAG, "=========================================");
     ESP_LOGI(TAG, "  System ready - waiting for scans");
     ESP_LOGI(TAG, "=========================================");
@@ -0,0 +1,532 @@
+/*
+ * Display panel drivers: SSD1306, SH1106 and SSD1327 controllers over I2C
+ * or 4-wire SPI, selected at build time in panel.h.
+ *
+ * main.c keeps a 1-bit-per-pixel page-packed framebuffer and hands dirty
+ * page ranges to panel_write_page(). Controllers turn those into address
+ * windows (converting to grayscale where the panel needs it) and pass them
+ * to the bus, which sends them synchronously (I2C) or queues them for DMA
+ * (SPI).
+ */
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_err.h"
+#include "driver/i2c_master.h"
+#include "driver/spi_master.h"
+#include "driver/gpio.h"
+
+#include "panel.h"
+
+static const char *TAG = "PANEL";
+
+// Longest window command sequence any controller sends before page data
+#define PANEL_MAX_WINDOW_CMDS   6
+
+// Bytes of panel data for one full 8-row page
+#define PANEL_PAGE_BYTES        (PANEL_WIDTH * PANEL_BPP)
+
+/* ================= BUS INTERFACE ================= */
+
+// write() sends a command sequence followed, if data_len > 0, by pixel
+// data. The data must stay untouched until wait() returns.
+typedef struct {
+    const char *name;
+    esp_err_t (*init)(void);
+    esp_err_t (*write)(const uint8_t *cmds, size_t cmd_len, const uint8_t *data, size_t data_len);
+    void (*wait)(void);
+    void (*deinit)(void);
+} panel_bus_t;
+
+/* ================= I2C BUS ================= */
+
+#if PANEL_BUS == PANEL_BUS_I2C
+
+// I2C control bytes, common to all three controllers: 0x00 starts a command
+// stream, 0x40 a data stream, and 0x80 marks a single command byte followed
+// by another control byte, which lets one transfer carry commands and then
+// data.
+#define I2C_CTRL_CMD_STREAM     0x00
+#define I2C_CTRL_DATA_STREAM    0x40
+#define I2C_CTRL_CMD_SINGLE     0x80
+
+static i2c_master_bus_handle_t i2c_bus_handle = NULL;
+static i2c_master_dev_handle_t i2c_dev_handle = NULL;
+
+// Every transfer is staged here, so the data path never touches the heap
+static uint8_t i2c_tx_buf[PANEL_MAX_WINDOW_CMDS * 2 + 1 + PANEL_PAGE_BYTES];
+
+static void i2c_bus_deinit(void)
+{
+    if (i2c_dev_handle != NULL) {
+        i2c_master_bus_rm_device(i2c_dev_handle);
+        i2c_dev_handle = NULL;
+    }
+    if (i2c_bus_handle != NULL) {
+        i2c_del_master_bus(i2c_bus_handle);
+        i2c_bus_handle = NULL;
+    }
+}
+
+static esp_err_t i2c_bus_init(void)
+{
+    i2c_bus_deinit();
+
+    i2c_master_bus_config_t bus_config = {
+        .clk_source = I2C_CLK_SRC_DEFAULT,
+        .i2c_port = I2C_NUM_0,
+        .scl_io_num = PANEL_I2C_SCL_IO,
+        .sda_io_num = PANEL_I2C_SDA_IO,
+        .glitch_ignore_cnt = 7,
+        .flags.enable_internal_pullup = true,
+    };
+
+    esp_err_t err = i2c_new_master_bus(&bus_config, &i2c_bus_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to create I2C master bus: %s", esp_err_to_name(err));
+        i2c_bus_handle = NULL;
+        return err;
+    }
+
+    i2c_device_config_t dev_config = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = PANEL_I2C_ADDR,
+        .scl_speed_hz = PANEL_I2C_FREQ_HZ,
+    };
+
+    err = i2c_master_bus_add_device(i2c_bus_handle, &dev_config, &i2c_dev_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add panel device: %s", esp_err_to_name(err));
+        i2c_bus_deinit();
+        return err;
+    }
+
+    return ESP_OK;
+}
+
+static esp_err_t i2c_bus_write(const uint8_t *cmds, size_t cmd_len, const uint8_t *data, size_t data_len)
+{
+    uint8_t *p = i2c_tx_buf;
+
+    if (data_len == 0) {
+        if (1 + cmd_len > sizeof(i2c_tx_buf)) return ESP_ERR_INVALID_SIZE;
+        *p++ = I2C_CTRL_CMD_STREAM;
+        memcpy(p, cmds, cmd_len);
+        return i2c_master_transmit(i2c_dev_handle, i2c_tx_buf, 1 + cmd_len, 100);
+    }
+
+    if (cmd_len * 2 + 1 + data_len > sizeof(i2c_tx_buf)) return ESP_ERR_INVALID_SIZE;
+    for (size_t i = 0; i < cmd_len; i++) {
+        *p++ = I2C_CTRL_CMD_SINGLE;
+        *p++ = cmds[i];
+    }
+    *p++ = I2C_CTRL_DATA_STREAM;
+    memcpy(p, data, data_len);
+    return i2c_master_transmit(i2c_dev_handle, i2c_tx_buf, cmd_len * 2 + 1 + data_len, 100);
+}
+
+static void i2c_bus_wait(void)
+{
+    // i2c_master_transmit has already finished by the time it returns
+}
+
+static const panel_bus_t panel_bus = {
+    .name = "I2C",
+    .init = i2c_bus_init,
+    .write = i2c_bus_write,
+    .wait = i2c_bus_wait,
+    .deinit = i2c_bus_deinit,
+};
+
+/* ================= SPI BUS ================= */
+
+#elif PANEL_BUS == PANEL_BUS_SPI
+
+#define PANEL_SPI_HOST          SPI2_HOST
+#define SPI_QUEUE_DEPTH         (2 * PANEL_PAGES + 2)
+#define SPI_CMD_CHUNK           16
+
+static spi_device_handle_t spi_dev = NULL;
+static bool spi_bus_ready = false;
+
+// Transactions are used round-robin; a slot is only reused once its
+// transfer has been collected, and results come back in queue order
+static spi_transaction_t spi_trans[SPI_QUEUE_DEPTH];
+static uint8_t spi_cmd_buf[SPI_QUEUE_DEPTH][SPI_CMD_CHUNK];  // DMA can't read flash
+static int spi_next = 0;
+static int spi_pending = 0;
+
+// Sets the D/C line for each transaction just before it is clocked out
+static void IRAM_ATTR spi_pre_transfer(spi_transaction_t *t)
+{
+    gpio_set_level(PANEL_SPI_DC_IO, (uint32_t)(uintptr_t)t->user);
+}
+
+static esp_err_t spi_collect_one(void)
+{
+    spi_transaction_t *done;
+    esp_err_t err = spi_device_get_trans_result(spi_dev, &done, portMAX_DELAY);
+    if (err == ESP_OK) {
+        spi_pending--;
+    }
+    return err;
+}
+
+static esp_err_t spi_queue(const uint8_t *buf, size_t len, int dc)
+{
+    if (spi_pending == SPI_QUEUE_DEPTH) {
+        esp_err_t err = spi_collect_one();
+        if (err != ESP_OK) return err;
+    }
+
+    spi_transaction_t *t = &spi_trans[spi_next];
+    memset(t, 0, sizeof(*t));
+    t->length = len * 8;
+    t->tx_buffer = buf;
+    t->user = (void *)(uintptr_t)dc;
+
+    esp_err_t err = spi_device_queue_trans(spi_dev, t, portMAX_DELAY);
+    if (err == ESP_OK) {
+        spi_next = (spi_next + 1) % SPI_QUEUE_DEPTH;
+        spi_pending++;
+    }
+    return err;
+}
+
+static void spi_bus_wait(void)
+{
+    while (spi_pending > 0) {
+        if (spi_collect_one() != ESP_OK) {
+            ESP_LOGE(TAG, "SPI transfer failed");
+            spi_pending = 0;
+        }
+    }
+}
+
+static esp_err_t spi_bus_write(const uint8_t *cmds, size_t cmd_len, const uint8_t *data, size_t data_len)
+{
+    esp_err_t err = ESP_OK;
+
+    while (cmd_len > 0 && err == ESP_OK) {
+        size_t chunk = cmd_len < SPI_CMD_CHUNK ? cmd_len : SPI_CMD_CHUNK;
+        if (spi_pending == SPI_QUEUE_DEPTH) {
+            err = spi_collect_one();
+            if (err != ESP_OK) break;
+        }
+        memcpy(spi_cmd_buf[spi_next], cmds, chunk);
+        err = spi_queue(spi_cmd_buf[spi_next], chunk, 0);
+        cmds += chunk;
+        cmd_len -= chunk;
+    }
+
+    if (err == ESP_OK && data_len > 0) {
+        err = spi_queue(data, data_len, 1);
+    }
+    return err;
+}
+
+static void spi_bus_deinit(void)
+{
+    if (spi_dev != NULL) {
+        spi_bus_wait();
+        spi_bus_remove_device(spi_dev);
+        spi_dev = NULL;
+    }
+    if (spi_bus_ready) {
+        spi_bus_free(PANEL_SPI_HOST);
+        spi_bus_ready = false;
+    }
+}
+
+static esp_err_t spi_bus_init(void)
+{
+    spi_bus_deinit();
+
+    uint64_t pins = 1ULL << PANEL_SPI_DC_IO;
+    if (PANEL_SPI_RST_IO >= 0) {
+        pins |= 1ULL << PANEL_SPI_RST_IO;
+    }
+    gpio_config_t io_conf = {
+        .pin_bit_mask = pins,
+        .mode = GPIO_MODE_OUTPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    gpio_config(&io_conf);
+
+    if (PANEL_SPI_RST_IO >= 0) {
+        gpio_set_level(PANEL_SPI_RST_IO, 0);
+        vTaskDelay(pdMS_TO_TICKS(10));
+        gpio_set_level(PANEL_SPI_RST_IO, 1);
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    spi_bus_config_t bus_config = {
+        .mosi_io_num = PANEL_SPI_MOSI_IO,
+        .miso_io_num = -1,
+        .sclk_io_num = PANEL_SPI_SCLK_IO,
+        .quadwp_io_num = -1,
+        .quadhd_io_num = -1,
+        .max_transfer_sz = PANEL_PAGE_BYTES * 8,
+    };
+
+    esp_err_t err = spi_bus_initialize(PANEL_SPI_HOST, &bus_config, SPI_DMA_CH_AUTO);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to initialize SPI bus: %s", esp_err_to_name(err));
+        return err;
+    }
+    spi_bus_ready = true;
+
+    spi_device_interface_config_t dev_config = {
+        .mode = 0,
+        .clock_speed_hz = PANEL_SPI_CLOCK_HZ,
+        .spics_io_num = PANEL_SPI_CS_IO,
+        .queue_size = SPI_QUEUE_DEPTH,
+        .pre_cb = spi_pre_transfer,
+    };
+
+    err = spi_bus_add_device(PANEL_SPI_HOST, &dev_config, &spi_dev);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to add panel device: %s", esp_err_to_name(err));
+        spi_dev = NULL;
+        spi_bus_deinit();
+        return err;
+    }
+
+    spi_next = 0;
+    spi_pending = 0;
+    return ESP_OK;
+}
+
+static const panel_bus_t panel_bus = {
+    .name = "SPI",
+    .init = spi_bus_init,
+    .write = spi_bus_write,
+    .wait = spi_bus_wait,
+    .deinit = spi_bus_deinit,
+};
+
+#else
+#error "Unknown PANEL_BUS"
+#endif
+
+/* ================= CONTROLLER INTERFACE ================= */
+
+typedef struct {
+    const char *name;
+    const uint8_t *init_cmds;
+    size_t init_len;
+    esp_err_t (*write_page)(int page, int x0, int x1, const uint8_t *row);
+} panel_controller_t;
+
+/* ================= SSD1306 ================= */
+
+#if PANEL_CONTROLLER == PANEL_SSD1306
+
+#define OLED_CMD_DISPLAY_OFF        0xAE
+#define OLED_CMD_DISPLAY_ON         0xAF
+#define OLED_CMD_SET_MUX_RATIO      0xA8
+#define OLED_CMD_SET_DISPLAY_OFFSET 0xD3
+#define OLED_CMD_SET_START_LINE     0x40
+#define OLED_CMD_SET_SEG_REMAP      0xA1
+#define OLED_CMD_SET_COM_SCAN_DEC   0xC8
+#define OLED_CMD_SET_COM_PINS       0xDA
+#define OLED_CMD_SET_CONTRAST       0x81
+#define OLED_CMD_ENTIRE_DISPLAY_ON  0xA4
+#define OLED_CMD_SET_NORMAL_DISPLAY 0xA6
+#define OLED_CMD_SET_OSC_FREQ       0xD5
+#define OLED_CMD_SET_CHARGE_PUMP    0x8D
+#define OLED_CMD_SET_MEMORY_MODE    0x20
+#define OLED_CMD_SET_COL_ADDR       0x21
+#define OLED_CMD_SET_PAGE_ADDR      0x22
+
+static const uint8_t ssd1306_init_cmds[] = {
+    OLED_CMD_DISPLAY_OFF,
+    OLED_CMD_SET_MUX_RATIO, PANEL_HEIGHT - 1,
+    OLED_CMD_SET_DISPLAY_OFFSET, 0x00,
+    OLED_CMD_SET_START_LINE | 0x00,
+    OLED_CMD_SET_SEG_REMAP,
+    OLED_CMD_SET_COM_SCAN_DEC,
+    OLED_CMD_SET_COM_PINS, PANEL_HEIGHT == 32 ? 0x02 : 0x12,
+    OLED_CMD_SET_CONTRAST, 0xCF,
+    OLED_CMD_ENTIRE_DISPLAY_ON,
+    OLED_CMD_SET_NORMAL_DISPLAY,
+    OLED_CMD_SET_OSC_FREQ, 0x80,
+    OLED_CMD_SET_CHARGE_PUMP, 0x14,
+    OLED_CMD_SET_MEMORY_MODE, 0x00,     // Horizontal addressing
+    OLED_CMD_DISPLAY_ON,
+};
+
+static esp_err_t ssd1306_write_page(int page, int x0, int x1, const uint8_t *row)
+{
+    const uint8_t cmds[] = {
+        OLED_CMD_SET_COL_ADDR, x0, x1,
+        OLED_CMD_SET_PAGE_ADDR, page, page,
+    };
+    return panel_bus.write(cmds, sizeof(cmds), &row[x0], x1 - x0 + 1);
+}
+
+static const panel_controller_t panel_controller = {
+    .name = "SSD1306",
+    .init_cmds = ssd1306_init_cmds,
+    .init_len = sizeof(ssd1306_init_cmds),
+    .write_page = ssd1306_write_page,
+};
+
+/* ================= SH1106 ================= */
+
+#elif PANEL_CONTROLLER == PANEL_SH1106
+
+// 132-column RAM with the visible 128 starting at column 2. There is no
+// horizontal addressing mode, so every page write sets page and column.
+#define SH1106_COLUMN_OFFSET        2
+#define SH1106_CMD_SET_PAGE         0xB0
+#define SH1106_CMD_SET_COL_LOW      0x00
+#define SH1106_CMD_SET_COL_HIGH     0x10
+
+static const uint8_t sh1106_init_cmds[] = {
+    0xAE,                       // Display off
+    0xD5, 0x80,                 // Clock divide / oscillator
+    0xA8, PANEL_HEIGHT - 1,     // Multiplex ratio
+    0xD3, 0x00,                 // Display offset
+    0x40,                       // Start line 0
+    0xAD, 0x8B,                 // DC-DC converter on
+    0xA1,                       // Segment remap
+    0xC8,                       // COM scan descending
+    0xDA, 0x12,                 // COM pins
+    0x81, 0xCF,                 // Contrast
+    0xD9, 0x1F,                 // Pre-charge period
+    0xDB, 0x40,                 // VCOM deselect level
+    0xA4,                       // Display follows RAM
+    0xA6,                       // Normal (not inverted)
+    0xAF,                       // Display on
+};
+
+static esp_err_t sh1106_write_page(int page, int x0, int x1, const uint8_t *row)
+{
+    int col = x0 + SH1106_COLUMN_OFFSET;
+    const uint8_t cmds[] = {
+        SH1106_CMD_SET_PAGE | page,
+        SH1106_CMD_SET_COL_LOW | (col & 0x0F),
+        SH1106_CMD_SET_COL_HIGH | (col >> 4),
+    };
+    return panel_bus.write(cmds, sizeof(cmds), &row[x0], x1 - x0 + 1);
+}
+
+static const panel_controller_t panel_controller = {
+    .name = "SH1106",
+    .init_cmds = sh1106_init_cmds,
+    .init_len = sizeof(sh1106_init_cmds),
+    .write_page = sh1106_write_page,
+};
+
+/* ================= SSD1327 ================= */
+
+#elif PANEL_CONTROLLER == PANEL_SSD1327
+
+// 4 bits per pixel, two horizontally adjacent pixels per byte with the left
+// one in the high nibble (given the remap below). Column addresses count
+// byte pairs, row addresses count pixel rows.
+#define SSD1327_CMD_SET_COL_ADDR    0x15
+#define SSD1327_CMD_SET_ROW_ADDR    0x75
+
+static const uint8_t ssd1327_init_cmds[] = {
+    0xAE,                       // Display off
+    0x81, 0x80,                 // Contrast
+    0xA0, 0x51,                 // Remap: column + nibble, COM split
+    0xA1, 0x00,                 // Start line
+    0xA2, 0x00,                 // Display offset
+    0xA4,                       // Normal display
+    0xA8, PANEL_HEIGHT - 1,     // Multiplex ratio
+    0xB1, 0xF1,                 // Phase length
+    0xB3, 0x00,                 // Clock divider
+    0xAB, 0x01,                 // Internal VDD regulator
+    0xB6, 0x0F,                 // Second pre-charge
+    0xBE, 0x0F,                 // VCOMH
+    0xBC, 0x08,                 // Pre-charge voltage
+    0xD5, 0x62,                 // Function selection B
+    0xFD, 0x12,                 // Unlock commands
+    0xAF,                       // Display on
+};
+
+// One staging area per page: on SPI several pages can be in flight at once
+static uint8_t ssd1327_stage[PANEL_PAGES][PANEL_PAGE_BYTES];
+
+static esp_err_t ssd1327_write_page(int page, int x0, int x1, const uint8_t *row)
+{
+    x0 &= ~1;
+    x1 |= 1;
+    int pairs = (x1 - x0 + 1) / 2;
+    uint8_t *out = ssd1327_stage[page];
+
+    for (int bit = 0; bit < 8; bit++) {
+        for (int x = x0; x <= x1; x += 2) {
+            uint8_t left = (row[x] >> bit) & 1 ? PANEL_GRAY_LEVEL << 4 : 0;
+            uint8_t right = (row[x + 1] >> bit) & 1 ? PANEL_GRAY_LEVEL : 0;
+            *out++ = left | right;
+        }
+    }
+
+    const uint8_t cmds[] = {
+        SSD1327_CMD_SET_COL_ADDR, x0 / 2, x1 / 2,
+        SSD1327_CMD_SET_ROW_ADDR, page * 8, page * 8 + 7,
+    };
+    return panel_bus.write(cmds, sizeof(cmds), ssd1327_stage[page], pairs * 8);
+}
+
+static const panel_controller_t panel_controller = {
+    .name = "SSD1327",
+    .init_cmds = ssd1327_init_cmds,
+    .init_len = sizeof(ssd1327_init_cmds),
+    .write_page = ssd1327_write_page,
+};
+
+#else
+#error "Unknown PANEL_CONTROLLER"
+#endif
+
+/* ================= PANEL API ================= */
+
+esp_err_t panel_init(void)
+{
+    ESP_LOGI(TAG, "Initializing %s panel over %s (%dx%d, %d bpp)...",
+             panel_controller.name, panel_bus.name, PANEL_WIDTH, PANEL_HEIGHT, PANEL_BPP);
+
+    esp_err_t err = panel_bus.init();
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(100));
+
+    // The whole init sequence goes out as a single command stream
+    err = panel_bus.write(panel_controller.init_cmds, panel_controller.init_len, NULL, 0);
+    panel_bus.wait();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Panel not responding - check wiring!");
+        panel_bus.deinit();
+        return err;
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t panel_write_page(int page, int x0, int x1, const uint8_t *row)
+{
+    return panel_controller.write_page(page, x0, x1, row);
+}
+
+void panel_wait(void)
+{
+    panel_bus.wait();
+}
+
+void panel_deinit(void)
+{
+    panel_bus.deinit();
+}
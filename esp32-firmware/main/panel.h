@@ -0,0 +1,103 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+/* ================= PANEL CONFIGURATION ================= */
+
+// Any of these can be overridden from main/CMakeLists.txt with
+// target_compile_definitions(${COMPONENT_LIB} PRIVATE PANEL_CONTROLLER=...)
+
+#define PANEL_SSD1306       1   // 128x64 / 128x32 monochrome
+#define PANEL_SH1106        2   // 128x64 monochrome, 132-column RAM
+#define PANEL_SSD1327       3   // 128x128 16-level grayscale
+
+#define PANEL_BUS_I2C       1
+#define PANEL_BUS_SPI       2
+
+#ifndef PANEL_CONTROLLER
+#define PANEL_CONTROLLER    PANEL_SSD1306
+#endif
+
+#ifndef PANEL_BUS
+#define PANEL_BUS           PANEL_BUS_I2C
+#endif
+
+// Geometry in pixels. The framebuffer is always 1 bit per pixel in 8-row
+// pages; screens are laid out for 128x64 and sit at the top of taller panels.
+#ifndef PANEL_WIDTH
+#define PANEL_WIDTH         128
+#endif
+
+#ifndef PANEL_HEIGHT
+#if PANEL_CONTROLLER == PANEL_SSD1327
+#define PANEL_HEIGHT        128
+#else
+#define PANEL_HEIGHT        64
+#endif
+#endif
+
+#define PANEL_PAGES         (PANEL_HEIGHT / 8)
+
+// Bits per pixel on the panel side; lit pixels on grayscale panels are
+// driven at PANEL_GRAY_LEVEL (0-15)
+#if PANEL_CONTROLLER == PANEL_SSD1327
+#define PANEL_BPP           4
+#else
+#define PANEL_BPP           1
+#endif
+
+#ifndef PANEL_GRAY_LEVEL
+#define PANEL_GRAY_LEVEL    0x0F
+#endif
+
+// I2C wiring
+#ifndef PANEL_I2C_SCL_IO
+#define PANEL_I2C_SCL_IO    9
+#endif
+#ifndef PANEL_I2C_SDA_IO
+#define PANEL_I2C_SDA_IO    8
+#endif
+#ifndef PANEL_I2C_FREQ_HZ
+#define PANEL_I2C_FREQ_HZ   400000
+#endif
+#ifndef PANEL_I2C_ADDR
+#define PANEL_I2C_ADDR      0x3C
+#endif
+
+// SPI wiring (4-wire: data/command select on its own pin)
+#ifndef PANEL_SPI_MOSI_IO
+#define PANEL_SPI_MOSI_IO   11
+#endif
+#ifndef PANEL_SPI_SCLK_IO
+#define PANEL_SPI_SCLK_IO   12
+#endif
+#ifndef PANEL_SPI_CS_IO
+#define PANEL_SPI_CS_IO     10
+#endif
+#ifndef PANEL_SPI_DC_IO
+#define PANEL_SPI_DC_IO     13
+#endif
+#ifndef PANEL_SPI_RST_IO
+#define PANEL_SPI_RST_IO    14      // -1 if tied to the board reset
+#endif
+#ifndef PANEL_SPI_CLOCK_HZ
+#define PANEL_SPI_CLOCK_HZ  (10 * 1000 * 1000)
+#endif
+
+/* ================= PANEL API ================= */
+
+// Brings up the bus and runs the controller's init sequence
+esp_err_t panel_init(void);
+
+// Writes columns x0..x1 of one framebuffer page. `row` points at the start
+// of that page in the framebuffer (PANEL_WIDTH bytes, bit 0 = top row) and
+// must stay unchanged until panel_wait() returns: on SPI the transfer runs
+// by DMA in the background.
+esp_err_t panel_write_page(int page, int x0, int x1, const uint8_t *row);
+
+// Blocks until every queued panel_write_page transfer has finished
+void panel_wait(void);
+
+void panel_deinit(void);
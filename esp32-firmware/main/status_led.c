@@ -0,0 +1,191 @@
+/*
+ * Status LED pattern engine on LEDC PWM.
+ *
+ * The current pattern is a small state record; status_led_show() and
+ * status_led_ack() update it and write the new duty cycles straight away,
+ * and an esp_timer steps the animation only while something is moving
+ * (a blink, breathe or double flash, or the ack flash running out).
+ */
+
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "driver/ledc.h"
+
+#include "status_led.h"
+
+static const char *TAG = "STATUS_LED";
+
+#define LED_DUTY_RES        LEDC_TIMER_10_BIT
+#define LED_DUTY_MAX        ((1 << 10) - 1)
+
+static const int led_gpio[LED_COUNT] = { LED_GREEN_GPIO, LED_YELLOW_GPIO, LED_RED_GPIO };
+static const ledc_channel_t led_channel[LED_COUNT] = { LEDC_CHANNEL_0, LEDC_CHANNEL_1, LEDC_CHANNEL_2 };
+
+static SemaphoreHandle_t led_mutex = NULL;
+static esp_timer_handle_t led_timer = NULL;
+
+static led_color_t led_color = LED_GREEN;
+static led_pattern_t led_pattern = LED_PATTERN_OFF;
+static int64_t led_pattern_start_us = 0;   // Patterns run from their own start
+static int64_t led_ack_until_us = 0;
+static uint32_t led_applied[LED_COUNT];
+
+/* ================= PATTERNS ================= */
+
+static uint32_t pattern_duty(led_pattern_t pattern, int64_t elapsed_ms)
+{
+    switch (pattern) {
+    case LED_PATTERN_SOLID:
+        return LED_DUTY_MAX;
+    case LED_PATTERN_BLINK:
+        return (elapsed_ms % 500) < 250 ? LED_DUTY_MAX : 0;
+    case LED_PATTERN_BREATHE: {
+        // Triangle wave squared, which looks close to linear to the eye
+        uint32_t phase = elapsed_ms % 2000;
+        uint32_t level = phase < 1000 ? phase : 2000 - phase;   // 0..1000
+        return level * level * LED_DUTY_MAX / 1000000;
+    }
+    case LED_PATTERN_DOUBLE_FLASH: {
+        uint32_t phase = elapsed_ms % 1200;
+        return (phase < 80 || (phase >= 200 && phase < 280)) ? LED_DUTY_MAX : 0;
+    }
+    case LED_PATTERN_OFF:
+    default:
+        return 0;
+    }
+}
+
+static bool pattern_animated(led_pattern_t pattern)
+{
+    return pattern != LED_PATTERN_OFF && pattern != LED_PATTERN_SOLID;
+}
+
+// Works out every LED's duty for now, writes the ones that changed, and
+// keeps the step timer running only while it has something to do.
+// Caller holds led_mutex.
+static void led_refresh(void)
+{
+    int64_t now = esp_timer_get_time();
+    bool acking = now < led_ack_until_us;
+
+    for (int i = 0; i < LED_COUNT; i++) {
+        uint32_t duty = 0;
+        if (acking) {
+            duty = LED_DUTY_MAX;
+        } else if (i == (int)led_color) {
+            duty = pattern_duty(led_pattern, (now - led_pattern_start_us) / 1000);
+        }
+        if (duty != led_applied[i]) {
+            ledc_set_duty(LEDC_LOW_SPEED_MODE, led_channel[i], duty);
+            ledc_update_duty(LEDC_LOW_SPEED_MODE, led_channel[i]);
+            led_applied[i] = duty;
+        }
+    }
+
+    bool moving = acking || pattern_animated(led_pattern);
+    bool running = esp_timer_is_active(led_timer);
+    if (moving && !running) {
+        esp_timer_start_periodic(led_timer, LED_TICK_MS * 1000);
+    } else if (!moving && running) {
+        esp_timer_stop(led_timer);
+    }
+}
+
+static void led_timer_callback(void *arg)
+{
+    xSemaphoreTake(led_mutex, portMAX_DELAY);
+    led_refresh();
+    xSemaphoreGive(led_mutex);
+}
+
+/* ================= PUBLIC API ================= */
+
+esp_err_t status_led_init(void)
+{
+    ESP_LOGI(TAG, "Initializing status LEDs...");
+
+    ledc_timer_config_t timer_config = {
+        .speed_mode = LEDC_LOW_SPEED_MODE,
+        .duty_resolution = LED_DUTY_RES,
+        .timer_num = LEDC_TIMER_0,
+        .freq_hz = LED_PWM_FREQ_HZ,
+        .clk_cfg = LEDC_AUTO_CLK,
+    };
+    esp_err_t err = ledc_timer_config(&timer_config);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "LEDC timer config failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    for (int i = 0; i < LED_COUNT; i++) {
+        ledc_channel_config_t channel_config = {
+            .gpio_num = led_gpio[i],
+            .speed_mode = LEDC_LOW_SPEED_MODE,
+            .channel = led_channel[i],
+            .intr_type = LEDC_INTR_DISABLE,
+            .timer_sel = LEDC_TIMER_0,
+            .duty = 0,
+            .hpoint = 0,
+        };
+        err = ledc_channel_config(&channel_config);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "LEDC channel config failed: %s", esp_err_to_name(err));
+            return err;
+        }
+        led_applied[i] = 0;
+    }
+
+    led_mutex = xSemaphoreCreateMutex();
+    if (led_mutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_timer_create_args_t timer_args = {
+        .callback = led_timer_callback,
+        .name = "status_led",
+    };
+    err = esp_timer_create(&timer_args, &led_timer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "LED timer create failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    ESP_LOGI(TAG, "LEDs initialized (Green=%d, Yellow=%d, Red=%d)",
+             LED_GREEN_GPIO, LED_YELLOW_GPIO, LED_RED_GPIO);
+    return ESP_OK;
+}
+
+void status_led_show(led_color_t color, led_pattern_t pattern)
+{
+    if (led_mutex == NULL) return;
+
+    xSemaphoreTake(led_mutex, portMAX_DELAY);
+    if (color != led_color || pattern != led_pattern) {
+        led_color = color;
+        led_pattern = pattern;
+        led_pattern_start_us = esp_timer_get_time();
+    }
+    led_refresh();
+    xSemaphoreGive(led_mutex);
+}
+
+void status_led_off(void)
+{
+    status_led_show(led_color, LED_PATTERN_OFF);
+}
+
+void status_led_ack(void)
+{
+    if (led_mutex == NULL) return;
+
+    xSemaphoreTake(led_mutex, portMAX_DELAY);
+    led_ack_until_us = esp_timer_get_time() + LED_ACK_MS * 1000;
+    led_refresh();
+    xSemaphoreGive(led_mutex);
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "esp_err.h"
+
+/*
+ * Non-blocking status LEDs: one of the three LEDs shows a pattern, driven by
+ * LEDC PWM and stepped from an esp_timer. Every call returns in
+ * microseconds, so it is safe from the HID callback path.
+ */
+
+// LED pins and PWM setup
+#define LED_GREEN_GPIO      4   // Healthy stock
+#define LED_YELLOW_GPIO     5   // Low stock / waiting
+#define LED_RED_GPIO        6   // Out of stock / not found / offline
+
+#define LED_PWM_FREQ_HZ     5000
+#define LED_TICK_MS         20      // Animation step while a pattern moves
+#define LED_ACK_MS          60      // All-LED flash when a scan is captured
+
+typedef enum {
+    LED_GREEN,
+    LED_YELLOW,
+    LED_RED,
+    LED_COUNT,
+} led_color_t;
+
+typedef enum {
+    LED_PATTERN_OFF,
+    LED_PATTERN_SOLID,
+    LED_PATTERN_BLINK,          // 250 ms on, 250 ms off
+    LED_PATTERN_BREATHE,        // 2 s fade in and out
+    LED_PATTERN_DOUBLE_FLASH,   // Two 80 ms flashes every 1.2 s
+} led_pattern_t;
+
+esp_err_t status_led_init(void);
+
+// Shows pattern on one LED and turns the other two off
+void status_led_show(led_color_t color, led_pattern_t pattern);
+
+void status_led_off(void);
+
+// Flashes all LEDs for LED_ACK_MS, then goes back to whatever
+// status_led_show last set. The LEDs change before this returns.
+void status_led_ack(void);
@@ -0,0 +1,264 @@
+/*
+ * Wi-Fi power-save policy and per-policy latency histograms.
+ *
+ * The fixed policies map straight onto esp_wifi_set_ps(). The adaptive
+ * policy drops to WIFI_PS_NONE on every captured scan and arms a one-shot
+ * esp_timer; when it fires after WIFI_POWER_IDLE_MS without another scan,
+ * the radio goes back to modem sleep.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "esp_wifi.h"
+#include "nvs.h"
+
+#include "wifi_power.h"
+
+static const char *TAG = "WIFI_POWER";
+
+#define WIFI_POWER_NVS_NAMESPACE    "wifi"
+#define WIFI_POWER_NVS_KEY          "ps_policy"
+
+static const char *const policy_names[WIFI_POWER_POLICY_COUNT] = {
+    [WIFI_POWER_NONE] = "none",
+    [WIFI_POWER_MIN_MODEM] = "min",
+    [WIFI_POWER_MAX_MODEM] = "max",
+    [WIFI_POWER_ADAPTIVE] = "adaptive",
+};
+
+static SemaphoreHandle_t power_mutex = NULL;
+static esp_timer_handle_t idle_timer = NULL;
+
+static wifi_power_policy_t power_policy = WIFI_POWER_DEFAULT_POLICY;
+static wifi_ps_type_t ps_applied = WIFI_PS_MIN_MODEM;   // Driver default after init
+
+/* ================= LATENCY HISTOGRAMS ================= */
+
+// Upper bounds in ms; the last bucket takes everything slower
+static const uint32_t latency_bounds_ms[] = { 10, 20, 50, 100, 200, 500, 1000 };
+#define LATENCY_BUCKETS (sizeof(latency_bounds_ms) / sizeof(latency_bounds_ms[0]) + 1)
+
+typedef struct {
+    uint32_t buckets[LATENCY_BUCKETS];
+    uint32_t count;
+    int64_t total_us;
+    int64_t max_us;
+} latency_histogram_t;
+
+static latency_histogram_t histograms[WIFI_POWER_POLICY_COUNT];
+static uint32_t requests_since_log = 0;
+
+/* ================= POWER SAVE ================= */
+
+// Caller holds power_mutex
+static void ps_apply(wifi_ps_type_t type)
+{
+    if (type == ps_applied) {
+        return;
+    }
+    esp_err_t err = esp_wifi_set_ps(type);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "esp_wifi_set_ps(%d) failed: %s", type, esp_err_to_name(err));
+        return;
+    }
+    ps_applied = type;
+}
+
+// Caller holds power_mutex
+static void ps_apply_policy(void)
+{
+    switch (power_policy) {
+    case WIFI_POWER_NONE:
+        ps_apply(WIFI_PS_NONE);
+        break;
+    case WIFI_POWER_MAX_MODEM:
+        ps_apply(WIFI_PS_MAX_MODEM);
+        break;
+    case WIFI_POWER_ADAPTIVE:
+        // Idle until the first scan says otherwise
+        esp_timer_stop(idle_timer);
+        ps_apply(WIFI_PS_MIN_MODEM);
+        break;
+    case WIFI_POWER_MIN_MODEM:
+    default:
+        ps_apply(WIFI_PS_MIN_MODEM);
+        break;
+    }
+}
+
+static void idle_timer_callback(void *arg)
+{
+    xSemaphoreTake(power_mutex, portMAX_DELAY);
+    if (power_policy == WIFI_POWER_ADAPTIVE) {
+        ESP_LOGI(TAG, "Idle - modem sleep on");
+        ps_apply(WIFI_PS_MIN_MODEM);
+    }
+    xSemaphoreGive(power_mutex);
+}
+
+static void policy_save(wifi_power_policy_t policy)
+{
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(WIFI_POWER_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (err == ESP_OK) {
+        err = nvs_set_u8(nvs, WIFI_POWER_NVS_KEY, (uint8_t)policy);
+        if (err == ESP_OK) {
+            err = nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Could not save policy: %s", esp_err_to_name(err));
+    }
+}
+
+/* ================= PUBLIC API ================= */
+
+esp_err_t wifi_power_init(void)
+{
+    power_mutex = xSemaphoreCreateMutex();
+    if (power_mutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = idle_timer_callback,
+        .name = "wifi_power",
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &idle_timer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Idle timer create failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    nvs_handle_t nvs;
+    uint8_t saved;
+    if (nvs_open(WIFI_POWER_NVS_NAMESPACE, NVS_READONLY, &nvs) == ESP_OK) {
+        if (nvs_get_u8(nvs, WIFI_POWER_NVS_KEY, &saved) == ESP_OK && saved < WIFI_POWER_POLICY_COUNT) {
+            power_policy = (wifi_power_policy_t)saved;
+        }
+        nvs_close(nvs);
+    }
+
+    ESP_LOGI(TAG, "Power save policy: %s", policy_names[power_policy]);
+    xSemaphoreTake(power_mutex, portMAX_DELAY);
+    ps_applied = WIFI_PS_MIN_MODEM;
+    ps_apply_policy();
+    xSemaphoreGive(power_mutex);
+    return ESP_OK;
+}
+
+void wifi_power_set_policy(wifi_power_policy_t policy)
+{
+    if (policy >= WIFI_POWER_POLICY_COUNT) {
+        return;
+    }
+    xSemaphoreTake(power_mutex, portMAX_DELAY);
+    power_policy = policy;
+    ps_apply_policy();
+    xSemaphoreGive(power_mutex);
+
+    policy_save(policy);
+    ESP_LOGI(TAG, "Power save policy set to %s", policy_names[policy]);
+}
+
+wifi_power_policy_t wifi_power_get_policy(void)
+{
+    return power_policy;
+}
+
+const char *wifi_power_policy_name(wifi_power_policy_t policy)
+{
+    return policy < WIFI_POWER_POLICY_COUNT ? policy_names[policy] : "?";
+}
+
+bool wifi_power_handle_barcode(const char *barcode, bool *accepted)
+{
+    size_t prefix_len = strlen(WIFI_POWER_BARCODE_PREFIX);
+    if (strncasecmp(barcode, WIFI_POWER_BARCODE_PREFIX, prefix_len) != 0) {
+        return false;
+    }
+
+    const char *name = barcode + prefix_len;
+    *accepted = false;
+    for (int i = 0; i < WIFI_POWER_POLICY_COUNT; i++) {
+        if (strcasecmp(name, policy_names[i]) == 0) {
+            wifi_power_set_policy((wifi_power_policy_t)i);
+            *accepted = true;
+            break;
+        }
+    }
+    if (!*accepted) {
+        ESP_LOGW(TAG, "Unknown power save policy '%s'", name);
+    }
+    return true;
+}
+
+void wifi_power_activity(void)
+{
+    if (power_mutex == NULL) {
+        return;
+    }
+    xSemaphoreTake(power_mutex, portMAX_DELAY);
+    if (power_policy == WIFI_POWER_ADAPTIVE) {
+        ps_apply(WIFI_PS_NONE);
+        esp_timer_stop(idle_timer);
+        esp_timer_start_once(idle_timer, (uint64_t)WIFI_POWER_IDLE_MS * 1000);
+    }
+    xSemaphoreGive(power_mutex);
+}
+
+void wifi_power_record_latency(int64_t elapsed_us)
+{
+    latency_histogram_t *h = &histograms[power_policy];
+
+    uint32_t elapsed_ms = (uint32_t)(elapsed_us / 1000);
+    size_t bucket = 0;
+    while (bucket < LATENCY_BUCKETS - 1 && elapsed_ms >= latency_bounds_ms[bucket]) {
+        bucket++;
+    }
+    h->buckets[bucket]++;
+    h->count++;
+    h->total_us += elapsed_us;
+    if (elapsed_us > h->max_us) {
+        h->max_us = elapsed_us;
+    }
+
+    if (++requests_since_log >= WIFI_POWER_STATS_EVERY) {
+        requests_since_log = 0;
+        wifi_power_log_stats();
+    }
+}
+
+void wifi_power_log_stats(void)
+{
+    for (int p = 0; p < WIFI_POWER_POLICY_COUNT; p++) {
+        const latency_histogram_t *h = &histograms[p];
+        if (h->count == 0) {
+            continue;
+        }
+
+        char line[160];
+        int len = snprintf(line, sizeof(line), "%-8s n=%-4lu avg %4lld ms, max %4lld ms |",
+                           policy_names[p], (unsigned long)h->count,
+                           (long long)(h->total_us / h->count / 1000), (long long)(h->max_us / 1000));
+        for (size_t b = 0; b < LATENCY_BUCKETS && len > 0 && len < (int)sizeof(line); b++) {
+            if (b < LATENCY_BUCKETS - 1) {
+                len += snprintf(line + len, sizeof(line) - len, " <%lu:%lu",
+                                (unsigned long)latency_bounds_ms[b], (unsigned long)h->buckets[b]);
+            } else {
+                len += snprintf(line + len, sizeof(line) - len, " >=%lu:%lu",
+                                (unsigned long)latency_bounds_ms[b - 1], (unsigned long)h->buckets[b]);
+            }
+        }
+        ESP_LOGI(TAG, "%s", line);
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+/*
+ * Wi-Fi modem power-save policy. Modem sleep holds inbound frames at the
+ * AP until the next DTIM beacon, which adds latency to every API response;
+ * the adaptive policy keeps the radio awake while the scanner is in use and
+ * lets it sleep once it has been idle for a while. Round-trip times are
+ * kept in a histogram per policy so the trade-off can be read off the log.
+ */
+
+#define WIFI_POWER_DEFAULT_POLICY   WIFI_POWER_ADAPTIVE
+#define WIFI_POWER_IDLE_MS          30000   // Adaptive: stay awake this long after a scan
+#define WIFI_POWER_STATS_EVERY      20      // Log the histograms every N requests
+
+// Scanning "WIFIPS-NONE" (or -MIN, -MAX, -ADAPTIVE) selects a policy; it is
+// kept in NVS across reboots. Only characters hid_keymap.h can decode.
+#define WIFI_POWER_BARCODE_PREFIX   "WIFIPS-"
+
+typedef enum {
+    WIFI_POWER_NONE,            // Radio always on: lowest latency, highest current
+    WIFI_POWER_MIN_MODEM,       // Wake for every DTIM beacon (ESP-IDF default)
+    WIFI_POWER_MAX_MODEM,       // Wake every listen interval
+    WIFI_POWER_ADAPTIVE,        // NONE while in use, MIN_MODEM when idle
+    WIFI_POWER_POLICY_COUNT,
+} wifi_power_policy_t;
+
+// Call after esp_wifi_init(); applies the policy saved in NVS, or
+// WIFI_POWER_DEFAULT_POLICY
+esp_err_t wifi_power_init(void);
+
+// Applies and saves a policy
+void wifi_power_set_policy(wifi_power_policy_t policy);
+
+wifi_power_policy_t wifi_power_get_policy(void);
+
+const char *wifi_power_policy_name(wifi_power_policy_t policy);
+
+// Returns false if barcode is not a configuration barcode; otherwise
+// *accepted tells whether it named a known policy
+bool wifi_power_handle_barcode(const char *barcode, bool *accepted);
+
+// A scan was captured. Under the adaptive policy this wakes the radio so the
+// request that follows does not wait for a beacon. Safe from the HID callback.
+void wifi_power_activity(void);
+
+// Adds one API round trip to the current policy's histogram
+void wifi_power_record_latency(int64_t elapsed_us);
+
+void wifi_power_log_stats(void);
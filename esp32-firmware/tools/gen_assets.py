@@ -0,0 +1,238 @@
+#!/usr/bin/env python3
+"""Generates the display assets header for the scanner firmware.
+
+Reads the pixel-art font (main/assets/font5x7.txt) and the static screen
+layouts (main/assets/screens.txt) and writes a C header with:
+
+  - FONT5X7_GLYPHS(X): one X(c0..c4) entry per glyph, columns bit 0 at top
+  - one RLE-compressed 128x64 page-format image per static screen
+
+Screen images use the same byte layout as the firmware framebuffer (one
+byte per column per 8-row page, bit 0 at the top). RLE stream:
+  0x80 | (n - 1), b     -> n copies of byte b          (n = 1..128)
+  n - 1, b0 .. b(n-1)   -> n literal bytes             (n = 1..128)
+
+Usage: gen_assets.py FONT SCREENS OUTPUT
+"""
+
+import os
+import sys
+
+FIRST_CHAR = 32
+LAST_CHAR = 126
+GLYPH_W = 5
+GLYPH_H = 7
+
+SCREEN_W = 128
+SCREEN_H = 64
+SCREEN_PAGES = SCREEN_H // 8
+
+
+def fail(path, lineno, msg):
+    sys.exit(f"{path}:{lineno}: {msg}")
+
+
+def load_font(path):
+    glyphs = {}
+    code = None
+    rows = []
+    with open(path, encoding="utf-8") as f:
+        for lineno, raw in enumerate(f, 1):
+            line = raw.rstrip("\n")
+            if not line.strip() or line.startswith("#") and code is None:
+                continue
+            if line.startswith("@"):
+                parts = line.split()
+                if len(parts) < 2:
+                    fail(path, lineno, "expected '@ <code>'")
+                code = int(parts[1], 0)
+                if not FIRST_CHAR <= code <= LAST_CHAR:
+                    fail(path, lineno, f"code {code} outside {FIRST_CHAR}..{LAST_CHAR}")
+                if code in glyphs:
+                    fail(path, lineno, f"duplicate glyph {code}")
+                rows = []
+                continue
+            if code is None:
+                fail(path, lineno, "pixel row before any '@' header")
+            if len(line) != GLYPH_W or set(line) - set("#."):
+                fail(path, lineno, f"expected {GLYPH_W} of '#' or '.'")
+            rows.append(line)
+            if len(rows) == GLYPH_H:
+                glyphs[code] = [
+                    sum(1 << r for r in range(GLYPH_H) if rows[r][c] == "#")
+                    for c in range(GLYPH_W)
+                ]
+                code = None
+
+    if code is not None:
+        fail(path, lineno, f"glyph {code} has {len(rows)} of {GLYPH_H} rows")
+    missing = [c for c in range(FIRST_CHAR, LAST_CHAR + 1) if c not in glyphs]
+    if missing:
+        sys.exit(f"{path}: missing glyphs {missing}")
+    return glyphs
+
+
+def load_screens(path):
+    screens = []
+    with open(path, encoding="utf-8") as f:
+        for lineno, raw in enumerate(f, 1):
+            line = raw.rstrip("\n")
+            if not line.strip() or line.startswith("#"):
+                continue
+            if line.startswith("["):
+                if not line.endswith("]"):
+                    fail(path, lineno, "expected '[name]'")
+                screens.append((line[1:-1], []))
+                continue
+            if not screens:
+                fail(path, lineno, "draw command before any '[name]'")
+            parts = line.split(" ", 3)
+            if len(parts) != 4 or parts[0] not in ("small", "large"):
+                fail(path, lineno, "expected 'small|large X Y TEXT'")
+            screens[-1][1].append((parts[0], int(parts[1]), int(parts[2]), parts[3]))
+    return screens
+
+
+def blit(fb, x, y, cols, repeat):
+    """ORs columns (bit 0 at row y) in like oled_blit_columns."""
+    if x < 0 or x >= SCREEN_W or y < 0 or y >= SCREEN_H:
+        return
+    for i in range(min(len(cols) * repeat, SCREEN_W - x)):
+        bits = cols[i // repeat] << y
+        for page in range(SCREEN_PAGES):
+            fb[page * SCREEN_W + x + i] |= (bits >> (page * 8)) & 0xFF
+
+
+def double_rows(col):
+    return sum(3 << (2 * r) for r in range(GLYPH_H) if col >> r & 1)
+
+
+def render(glyphs, commands):
+    fb = bytearray(SCREEN_W * SCREEN_PAGES)
+    for size, x, y, text in commands:
+        step = 6 if size == "small" else 12
+        for ch in text:
+            if x >= SCREEN_W:
+                break
+            code = ord(ch)
+            if FIRST_CHAR <= code <= LAST_CHAR:
+                cols = glyphs[code]
+                if size == "small":
+                    blit(fb, x, y, cols, 1)
+                else:
+                    blit(fb, x, y, [double_rows(c) for c in cols], 2)
+            x += step
+    return fb
+
+
+def rle(data):
+    out = bytearray()
+    i = 0
+    literal = bytearray()
+
+    def flush_literal():
+        while literal:
+            chunk = literal[:128]
+            out.append(len(chunk) - 1)
+            out.extend(chunk)
+            del literal[:128]
+
+    while i < len(data):
+        run = 1
+        while i + run < len(data) and run < 128 and data[i + run] == data[i]:
+            run += 1
+        # A run of 2 costs the same as two literals but splits a literal block
+        if run >= 3 or (run == 2 and not literal):
+            flush_literal()
+            out.append(0x80 | (run - 1))
+            out.append(data[i])
+            i += run
+        else:
+            literal.append(data[i])
+            i += 1
+    flush_literal()
+    return bytes(out)
+
+
+def unrle(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        n = (data[i] & 0x7F) + 1
+        if data[i] & 0x80:
+            out.extend(data[i + 1:i + 2] * n)
+            i += 2
+        else:
+            out.extend(data[i + 1:i + 1 + n])
+            i += 1 + n
+    return bytes(out)
+
+
+def c_bytes(data, indent="    "):
+    lines = []
+    for i in range(0, len(data), 12):
+        lines.append(indent + ", ".join(f"0x{b:02X}" for b in data[i:i + 12]) + ",")
+    return "\n".join(lines)
+
+
+def main():
+    if len(sys.argv) != 4:
+        sys.exit(__doc__.strip().splitlines()[-1])
+    font_path, screens_path, out_path = sys.argv[1:]
+
+    glyphs = load_font(font_path)
+    screens = load_screens(screens_path)
+
+    out = []
+    out.append("/* Generated by tools/gen_assets.py from "
+               f"{os.path.basename(font_path)} and {os.path.basename(screens_path)}."
+               " Do not edit. */")
+    out.append("#pragma once")
+    out.append("")
+    out.append("#include <stdint.h>")
+    out.append("")
+    out.append(f"#define FONT5X7_FIRST_CHAR {FIRST_CHAR}")
+    out.append(f"#define FONT5X7_LAST_CHAR  {LAST_CHAR}")
+    out.append("")
+    out.append("#define FONT5X7_GLYPHS(X) \\")
+    for code in range(FIRST_CHAR, LAST_CHAR + 1):
+        cols = ", ".join(f"0x{c:02X}" for c in glyphs[code])
+        out.append(f"    X({cols}) /* {code} */ \\")
+    out.append("")
+    out.append("")
+    out.append(f"#define ASSET_SCREEN_WIDTH {SCREEN_W}")
+    out.append(f"#define ASSET_SCREEN_PAGES {SCREEN_PAGES}")
+    out.append("")
+    out.append("typedef struct {")
+    out.append("    const uint8_t *rle;")
+    out.append("    uint16_t size;")
+    out.append("} asset_image_t;")
+
+    raw_total = 0
+    rle_total = 0
+    for name, commands in screens:
+        fb = render(glyphs, commands)
+        packed = rle(fb)
+        assert unrle(packed) == bytes(fb), name
+        raw_total += len(fb)
+        rle_total += len(packed)
+        ident = name.upper()
+        out.append("")
+        out.append(f"/* {name}: {len(packed)} bytes, {len(fb)} raw */")
+        out.append(f"static const uint8_t asset_{name}_rle[] = {{")
+        out.append(c_bytes(packed))
+        out.append("};")
+        out.append(f"#define ASSET_SCREEN_{ident} "
+                   f"((asset_image_t){{ asset_{name}_rle, sizeof(asset_{name}_rle) }})")
+    out.append("")
+
+    text = "\n".join(out)
+    os.makedirs(os.path.dirname(os.path.abspath(out_path)), exist_ok=True)
+    with open(out_path, "w", encoding="utf-8") as f:
+        f.write(text)
+    print(f"gen_assets: {LAST_CHAR - FIRST_CHAR + 1} glyphs, {len(screens)} screens "
+          f"({rle_total} bytes RLE, {raw_total} raw)")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,91 @@
+// Concurrent /api/scan benchmark against a single hot SKU.
+//
+//   npx tsx script/bench-scan.ts <barcode> [total] [concurrency]
+//
+// BENCH_URL selects the server (default http://localhost:5000). The scans
+// really change stock in the current scanner mode, so point it at a test
+// item. It reports latency percentiles and checks that the stock moved by
+// exactly the sum of the reported changes, i.e. no update was lost.
+
+const baseUrl = process.env.BENCH_URL || "http://localhost:5000";
+
+async function getJson(path: string) {
+  const res = await fetch(`${baseUrl}${path}`);
+  if (!res.ok) {
+    throw new Error(`GET ${path} failed: ${res.status}`);
+  }
+  return res.json();
+}
+
+function percentile(sorted: number[], p: number) {
+  if (sorted.length === 0) return 0;
+  const index = Math.min(sorted.length - 1, Math.ceil((p / 100) * sorted.length) - 1);
+  return sorted[Math.max(0, index)];
+}
+
+async function bench() {
+  const [barcode, totalArg, concurrencyArg] = process.argv.slice(2);
+  if (!barcode) {
+    console.error("usage: tsx script/bench-scan.ts <barcode> [total] [concurrency]");
+    process.exit(1);
+  }
+  const total = Number(totalArg || 200);
+  const concurrency = Number(concurrencyArg || 50);
+
+  const mode = await getJson("/api/scanner-mode");
+  const before = await getJson(`/api/item/${encodeURIComponent(barcode)}`);
+  console.log(`mode ${mode.mode} x${mode.quantity}, ${barcode} starts at ${before.quantity}`);
+
+  const latencies: number[] = [];
+  let netChange = 0;
+  let failures = 0;
+  let next = 0;
+
+  const worker = async () => {
+    while (next < total) {
+      next++;
+      const start = performance.now();
+      const res = await fetch(`${baseUrl}/api/scan`, {
+        method: "POST",
+        headers: { "Content-Type": "application/json" },
+        body: JSON.stringify({ barcode }),
+      });
+      const body = await res.json();
+      latencies.push(performance.now() - start);
+
+      if (!res.ok) {
+        failures++;
+      } else if (body.action === "DEDUCT") {
+        netChange -= body.quantityChanged || 0;
+      } else if (body.action === "ADD") {
+        netChange += body.quantityChanged || 0;
+      }
+    }
+  };
+
+  const started = performance.now();
+  await Promise.all(Array.from({ length: concurrency }, worker));
+  const elapsed = performance.now() - started;
+
+  const after = await getJson(`/api/item/${encodeURIComponent(barcode)}`);
+  latencies.sort((a, b) => a - b);
+
+  console.log(`${total} scans, ${concurrency} concurrent, ${failures} failed`);
+  console.log(`throughput ${(total / (elapsed / 1000)).toFixed(1)} scans/s`);
+  console.log(
+    `latency ms  p50 ${percentile(latencies, 50).toFixed(1)}  p95 ${percentile(latencies, 95).toFixed(1)}` +
+    `  p99 ${percentile(latencies, 99).toFixed(1)}  max ${latencies[latencies.length - 1].toFixed(1)}`,
+  );
+
+  const expected = before.quantity + netChange;
+  if (after.quantity !== expected) {
+    console.error(`LOST UPDATES: stock is ${after.quantity}, expected ${expected}`);
+    process.exit(1);
+  }
+  console.log(`stock ${before.quantity} -> ${after.quantity}, consistent with reported changes`);
+}
+
+bench().catch((err) => {
+  console.error(err);
+  process.exit(1);
+});
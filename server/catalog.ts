@@ -0,0 +1,223 @@
+// Compact binary item catalog for the scanner firmware.
+//
+// The image is a 32-byte header followed by fixed-size records sorted by
+// (FNV-1a hash of the barcode, barcode), so the device can binary search it
+// straight out of a memory-mapped flash partition. Deltas use the same
+// record layout with the DELETED flag marking removed items.
+//
+// Header (little endian):
+//   u32 magic  u16 format  u16 recordSize  u32 epoch  u32 version
+//   u32 count  u32 baseVersion (deltas only)  u8[8] reserved
+//
+// Record (128 bytes):
+//   u32 hash  i32 quantity  i32 originalStock  u8 flags  u8[3] pad
+//   char barcode[36]  char name[52]  char category[24]   (NUL padded)
+
+export const CATALOG_IMAGE_MAGIC = 0x54414349; // "ICAT"
+export const CATALOG_DELTA_MAGIC = 0x4c444349; // "ICDL"
+export const CATALOG_FORMAT = 1;
+export const CATALOG_HEADER_SIZE = 32;
+export const CATALOG_RECORD_SIZE = 128;
+export const CATALOG_FLAG_DELETED = 0x01;
+
+// Bloom filter of every known barcode, so the scanner can reject unknown
+// labels without a round trip. Header (little endian, 20 bytes):
+//   u32 magic  u32 epoch  u32 version  u32 bitCount  u8 hashCount  u8[3] pad
+// version is the barcode-set version, which only moves when a barcode is
+// added or removed; stock changes leave the filter (and devices' copies) alone.
+// followed by bitCount / 8 bytes of filter bits (bit i = byte i>>3, mask 1<<(i&7)).
+// Probe j tests bit (h1 + j * h2) % bitCount with h1 = barcodeHash(barcode)
+// and h2 = mix32(h1) | 1.
+export const BARCODE_FILTER_MAGIC = 0x464c4249; // "IBLF"
+export const BARCODE_FILTER_HEADER_SIZE = 20;
+const BARCODE_FILTER_BITS_PER_ITEM = 10; // ~1% false positives with 7 probes
+const BARCODE_FILTER_HASHES = 7;
+
+const BARCODE_FIELD = 36;
+const NAME_FIELD = 52;
+const CATEGORY_FIELD = 24;
+const MAX_CHANGE_LOG = 2000;
+
+export interface CatalogItem {
+  name: string;
+  category: string;
+  quantity: number;
+  originalStock: number;
+}
+
+export function barcodeHash(barcode: string): number {
+  const bytes = Buffer.from(barcode, 'utf8');
+  let hash = 0x811c9dc5;
+  for (let i = 0; i < bytes.length; i++) {
+    hash ^= bytes[i];
+    hash = Math.imul(hash, 0x01000193);
+  }
+  return hash >>> 0;
+}
+
+function mix32(h: number): number {
+  h ^= h >>> 16;
+  h = Math.imul(h, 0x85ebca6b);
+  h ^= h >>> 13;
+  h = Math.imul(h, 0xc2b2ae35);
+  h ^= h >>> 16;
+  return h >>> 0;
+}
+
+function toCatalogItem(item: any): CatalogItem {
+  const quantity = Number(item?.quantity) || 0;
+  return {
+    name: item?.name || '',
+    category: item?.category || '',
+    quantity,
+    originalStock: Number(item?.originalStock) || quantity,
+  };
+}
+
+function sameItem(a: CatalogItem, b: CatalogItem) {
+  return a.name === b.name &&
+    a.category === b.category &&
+    a.quantity === b.quantity &&
+    a.originalStock === b.originalStock;
+}
+
+function writeField(buf: Buffer, offset: number, size: number, value: string) {
+  const bytes = Buffer.from(value, 'utf8');
+  bytes.copy(buf, offset, 0, Math.min(bytes.length, size - 1));
+}
+
+export class CatalogIndex {
+  // Changes a device made against an older server process are meaningless,
+  // so every image and delta carries the epoch it was produced in
+  readonly epoch = Math.floor(Date.now() / 1000) >>> 0;
+  version = 0;
+  barcodeSetVersion = 0;
+
+  private items = new Map<string, CatalogItem>();
+  private changes: { version: number; barcode: string }[] = [];
+  private barcodeFilter: Buffer | null = null;
+  private barcodeFilterVersion = -1;
+
+  // Returns true when the catalog-relevant fields actually changed
+  upsert(barcode: string, raw: any): boolean {
+    const next = toCatalogItem(raw);
+    const prev = this.items.get(barcode);
+    if (prev && sameItem(prev, next)) {
+      return false;
+    }
+    if (!prev) {
+      this.barcodeSetVersion++;
+    }
+    this.items.set(barcode, next);
+    this.recordChange(barcode);
+    return true;
+  }
+
+  remove(barcode: string): boolean {
+    if (!this.items.delete(barcode)) {
+      return false;
+    }
+    this.barcodeSetVersion++;
+    this.recordChange(barcode);
+    return true;
+  }
+
+  private recordChange(barcode: string) {
+    this.version++;
+    this.changes.push({ version: this.version, barcode });
+    if (this.changes.length > MAX_CHANGE_LOG) {
+      this.changes.splice(0, this.changes.length - MAX_CHANGE_LOG);
+    }
+  }
+
+  private writeHeader(buf: Buffer, magic: number, count: number, baseVersion: number) {
+    buf.writeUInt32LE(magic, 0);
+    buf.writeUInt16LE(CATALOG_FORMAT, 4);
+    buf.writeUInt16LE(CATALOG_RECORD_SIZE, 6);
+    buf.writeUInt32LE(this.epoch, 8);
+    buf.writeUInt32LE(this.version, 12);
+    buf.writeUInt32LE(count, 16);
+    buf.writeUInt32LE(baseVersion, 20);
+  }
+
+  private writeRecord(buf: Buffer, offset: number, barcode: string, item: CatalogItem | undefined) {
+    buf.writeUInt32LE(barcodeHash(barcode), offset);
+    buf.writeInt32LE(item?.quantity ?? 0, offset + 4);
+    buf.writeInt32LE(item?.originalStock ?? 0, offset + 8);
+    buf.writeUInt8(item ? 0 : CATALOG_FLAG_DELETED, offset + 12);
+    writeField(buf, offset + 16, BARCODE_FIELD, barcode);
+    writeField(buf, offset + 16 + BARCODE_FIELD, NAME_FIELD, item?.name ?? '');
+    writeField(buf, offset + 16 + BARCODE_FIELD + NAME_FIELD, CATEGORY_FIELD, item?.category ?? '');
+  }
+
+  private sorted(barcodes: string[]) {
+    return barcodes
+      .map((barcode) => ({ barcode, hash: barcodeHash(barcode) }))
+      .sort((a, b) => a.hash - b.hash || (a.barcode < b.barcode ? -1 : a.barcode > b.barcode ? 1 : 0))
+      .map(({ barcode }) => barcode);
+  }
+
+  buildImage(): Buffer {
+    const barcodes = this.sorted(Array.from(this.items.keys()));
+    const buf = Buffer.alloc(CATALOG_HEADER_SIZE + barcodes.length * CATALOG_RECORD_SIZE);
+    this.writeHeader(buf, CATALOG_IMAGE_MAGIC, barcodes.length, 0);
+    barcodes.forEach((barcode, i) => {
+      this.writeRecord(buf, CATALOG_HEADER_SIZE + i * CATALOG_RECORD_SIZE, barcode, this.items.get(barcode));
+    });
+    return buf;
+  }
+
+  // Rebuilt lazily, at most once per barcode-set version
+  buildBarcodeFilter(): Buffer {
+    if (this.barcodeFilter && this.barcodeFilterVersion === this.barcodeSetVersion) {
+      return this.barcodeFilter;
+    }
+
+    const bitCount = Math.max(64, Math.ceil((this.items.size * BARCODE_FILTER_BITS_PER_ITEM) / 8) * 8);
+    const buf = Buffer.alloc(BARCODE_FILTER_HEADER_SIZE + bitCount / 8);
+    buf.writeUInt32LE(BARCODE_FILTER_MAGIC, 0);
+    buf.writeUInt32LE(this.epoch, 4);
+    buf.writeUInt32LE(this.barcodeSetVersion, 8);
+    buf.writeUInt32LE(bitCount, 12);
+    buf.writeUInt8(BARCODE_FILTER_HASHES, 16);
+
+    Array.from(this.items.keys()).forEach((barcode) => {
+      const h1 = barcodeHash(barcode);
+      const h2 = (mix32(h1) | 1) >>> 0;
+      for (let j = 0; j < BARCODE_FILTER_HASHES; j++) {
+        const bit = (h1 + j * h2) % bitCount;
+        buf[BARCODE_FILTER_HEADER_SIZE + (bit >>> 3)] |= 1 << (bit & 7);
+      }
+    });
+
+    this.barcodeFilter = buf;
+    this.barcodeFilterVersion = this.barcodeSetVersion;
+    return buf;
+  }
+
+  // Returns null when the device has to fall back to a full image: another
+  // server epoch, a version from the future, or history already trimmed.
+  buildDelta(epoch: number, since: number): Buffer | null {
+    if (epoch !== this.epoch || since > this.version) {
+      return null;
+    }
+    if (since < this.version && (this.changes.length === 0 || this.changes[0].version > since + 1)) {
+      return null;
+    }
+
+    const touched = new Set<string>();
+    for (const change of this.changes) {
+      if (change.version > since) {
+        touched.add(change.barcode);
+      }
+    }
+
+    const barcodes = this.sorted(Array.from(touched));
+    const buf = Buffer.alloc(CATALOG_HEADER_SIZE + barcodes.length * CATALOG_RECORD_SIZE);
+    this.writeHeader(buf, CATALOG_DELTA_MAGIC, barcodes.length, since);
+    barcodes.forEach((barcode, i) => {
+      this.writeRecord(buf, CATALOG_HEADER_SIZE + i * CATALOG_RECORD_SIZE, barcode, this.items.get(barcode));
+    });
+    return buf;
+  }
+}
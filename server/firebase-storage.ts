@@ -0,0 +1,233 @@
+import type { DataSnapshot, Query } from "firebase-admin/database";
+import admin, { db } from "./firebase";
+import type { JournalEntry } from "./transaction-journal";
+import {
+  DEFAULT_SCANNER_MODE,
+  dayBucket,
+  rollupCounter,
+  type DayRollup,
+  type IInventoryStorage,
+  type InventoryListener,
+  type ItemRollup,
+  type StoredItem,
+  type StoredTransaction,
+} from "./storage";
+import type { ScannerMode } from "@shared/schema";
+
+// Day buckets looked up per round trip when reading recent history
+const RECENT_DAYS_PAGE = 31;
+
+// Realtime Database layout:
+//   items/<barcode>
+//   scannerMode
+//   transactionLog/<YYYY-MM-DD>/<pushId>
+//   rollups/items/<barcode>, rollups/days/<day>, rollups/itemDays/<day>/<barcode>
+//   transactions/<pushId>   legacy flat log, read-only
+export class FirebaseInventoryStorage implements IInventoryStorage {
+  private itemsRef = db.ref('items');
+  private transactionsRef = db.ref('transactions');
+  private transactionLogRef = db.ref('transactionLog');
+  private rollupsRef = db.ref('rollups');
+  private scannerModeRef = db.ref('scannerMode');
+  private transactionQuery: Query | null = null;
+
+  subscribe(listener: InventoryListener) {
+    let markScannerModeReady!: () => void;
+    const scannerModeReady = new Promise<void>((resolve) => { markScannerModeReady = resolve; });
+
+    const onItemUpserted = (snapshot: DataSnapshot) => {
+      listener.itemUpserted(snapshot.key as string, snapshot.val());
+    };
+    this.itemsRef.on('child_added', onItemUpserted);
+    this.itemsRef.on('child_changed', onItemUpserted);
+    this.itemsRef.on('child_removed', (snapshot) => {
+      listener.itemRemoved(snapshot.key as string);
+    });
+
+    // Initial children replay through child_added before the first 'value'
+    const itemsReady = this.itemsRef.once('value').then(() => undefined);
+
+    this.scannerModeRef.on('value', (snapshot) => {
+      listener.scannerModeChanged(snapshot.val() || DEFAULT_SCANNER_MODE);
+      markScannerModeReady();
+    });
+
+    // Only transactions written from now on are news, so history isn't
+    // replayed through child_added. The query follows the current day
+    // bucket across UTC midnight.
+    const onTransactionAdded = (snapshot: DataSnapshot) => {
+      const transaction = snapshot.val();
+      if (transaction) {
+        listener.transactionAdded(snapshot.key as string, transaction);
+      }
+    };
+
+    const watchTransactionDay = (since: number) => {
+      this.transactionQuery?.off('child_added', onTransactionAdded);
+      this.transactionQuery = this.transactionLogRef.child(dayBucket(since)).orderByChild('timestamp').startAt(since);
+      this.transactionQuery.on('child_added', onTransactionAdded);
+
+      const nextDay = new Date(since);
+      nextDay.setUTCHours(24, 0, 0, 0);
+      setTimeout(() => watchTransactionDay(nextDay.getTime()), nextDay.getTime() - since);
+    };
+
+    watchTransactionDay(Date.now());
+
+    return { itemsReady, scannerModeReady };
+  }
+
+  async putItem(barcode: string, item: StoredItem) {
+    await this.itemsRef.child(barcode).set(item);
+  }
+
+  async updateItem(barcode: string, fields: Partial<StoredItem>) {
+    await this.itemsRef.child(barcode).update(fields);
+  }
+
+  async removeItem(barcode: string) {
+    await this.itemsRef.child(barcode).remove();
+  }
+
+  async setScannerMode(mode: ScannerMode) {
+    await this.scannerModeRef.set(mode);
+  }
+
+  newTransactionKey() {
+    return this.transactionLogRef.push().key as string;
+  }
+
+  // Transaction records plus their rollup increments for one batch, as a
+  // single multi-path update. Increments to the same path are summed,
+  // since a multi-path update holds one value per path. Entries whose
+  // record is already stored are skipped, so a batch written twice (journal
+  // replay, or a retry after an update that did land) counts once.
+  async writeTransactions(entries: JournalEntry[]) {
+    const written = await this.storedTransactionKeys(entries);
+    const fresh = entries.filter(({ key }) => !written.has(key));
+    if (fresh.length === 0) return;
+
+    const updates: Record<string, unknown> = {};
+    const increments = new Map<string, number>();
+    const bump = (path: string, amount: number) => increments.set(path, (increments.get(path) || 0) + amount);
+
+    for (const { key, transaction } of fresh) {
+      const day = dayBucket(transaction.timestamp);
+      const counter = rollupCounter(transaction.action);
+      const amount = transaction.action === 'VIEW' ? 1 : transaction.quantity;
+
+      updates[`transactionLog/${day}/${key}`] = transaction;
+      updates[`rollups/items/${transaction.barcode}/lastScanAt`] = transaction.timestamp;
+      bump(`rollups/items/${transaction.barcode}/${counter}`, amount);
+      bump(`rollups/days/${day}/${counter}`, amount);
+      bump(`rollups/days/${day}/count`, 1);
+      bump(`rollups/itemDays/${day}/${transaction.barcode}/${counter}`, amount);
+    }
+
+    increments.forEach((amount, path) => {
+      updates[path] = admin.database.ServerValue.increment(amount);
+    });
+    await db.ref().update(updates);
+  }
+
+  // Push keys sort by creation time, so one key-range query per day finds
+  // which of a batch's records exist. Only this process writes the log and
+  // the journal flushes one batch at a time, so nothing lands in between.
+  private async storedTransactionKeys(entries: JournalEntry[]) {
+    const keysByDay = new Map<string, string[]>();
+    for (const { key, transaction } of entries) {
+      const day = dayBucket(transaction.timestamp);
+      const keys = keysByDay.get(day) || [];
+      keys.push(key);
+      keysByDay.set(day, keys);
+    }
+
+    const stored = new Set<string>();
+    await Promise.all(Array.from(keysByDay).map(async ([day, keys]) => {
+      keys.sort();
+      const snapshot = await this.transactionLogRef.child(day)
+        .orderByKey()
+        .startAt(keys[0])
+        .endAt(keys[keys.length - 1])
+        .once('value');
+      Object.keys(snapshot.val() || {}).forEach((key) => stored.add(key));
+    }));
+    return stored;
+  }
+
+  // Walks day buckets newest first, a page of rollups/days at a time, then
+  // tops up from the legacy flat log. The rollup counts say how many records
+  // each bucket holds, so each bucket is asked for just its share and the
+  // buckets of a page are read together.
+  async recentTransactions(limit: number) {
+    const collected: [string, StoredTransaction][] = [];
+    let olderThan: string | null = null;
+
+    while (collected.length < limit) {
+      let daysQuery = this.rollupsRef.child('days').orderByKey();
+      if (olderThan) {
+        daysQuery = daysQuery.endAt(olderThan);
+      }
+      const daysSnapshot = await daysQuery.limitToLast(RECENT_DAYS_PAGE + (olderThan ? 1 : 0)).once('value');
+      const days = Object.entries(daysSnapshot.val() || {})
+        .filter(([day]) => day !== olderThan)
+        .sort(([a], [b]) => (a < b ? 1 : a > b ? -1 : 0)) as [string, any][];
+      if (days.length === 0) break;
+
+      const reads: [string, number][] = [];
+      let wanted = limit - collected.length;
+      for (const [day, counts] of days) {
+        if (wanted <= 0) break;
+        const take = counts?.count > 0 ? Math.min(counts.count, wanted) : wanted;
+        reads.push([day, take]);
+        wanted -= take;
+      }
+
+      const pages = await Promise.all(reads.map(async ([day, take]) => {
+        const snapshot = await this.transactionLogRef.child(day)
+          .orderByChild('timestamp')
+          .limitToLast(take)
+          .once('value');
+        return Object.entries(snapshot.val() || {}) as [string, StoredTransaction][];
+      }));
+      pages.forEach((entries) => collected.push(...entries));
+
+      // Resume below the last bucket read, so buckets this page skipped
+      // because the counts promised enough are read if they fell short
+      olderThan = reads[reads.length - 1][0];
+    }
+
+    if (collected.length < limit) {
+      const legacySnapshot = await this.transactionsRef.orderByChild('timestamp')
+        .limitToLast(limit - collected.length)
+        .once('value');
+      collected.push(...(Object.entries(legacySnapshot.val() || {}) as [string, StoredTransaction][]));
+    }
+
+    return collected;
+  }
+
+  async dayRollups(limit: number): Promise<DayRollup[]> {
+    const snapshot = await this.rollupsRef.child('days').orderByKey().limitToLast(limit).once('value');
+    const data = snapshot.val() || {};
+    return Object.entries(data).map(([day, counts]: [string, any]) => ({
+      day,
+      added: counts.added || 0,
+      deducted: counts.deducted || 0,
+      views: counts.views || 0,
+      count: counts.count || 0,
+    }));
+  }
+
+  async itemRollups(): Promise<ItemRollup[]> {
+    const snapshot = await this.rollupsRef.child('items').once('value');
+    const data = snapshot.val() || {};
+    return Object.entries(data).map(([barcode, counts]: [string, any]) => ({
+      barcode,
+      added: counts.added || 0,
+      deducted: counts.deducted || 0,
+      views: counts.views || 0,
+      lastScanAt: counts.lastScanAt || null,
+    }));
+  }
+}
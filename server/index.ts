@@ -85,6 +85,12 @@ app.use((req, res, next) => {
   // this serves both the API and the client.
   // It is the only port that is not firewalled.
   const port = parseInt(process.env.PORT || "5000", 10);
+
+  // Scanners hold one keep-alive TLS connection and ping it every 20 s
+  // (API_KEEPALIVE_MS in the firmware); Node's 5 s default would close it
+  // between scans and every scan would pay for a new handshake
+  httpServer.keepAliveTimeout = 65_000;
+  httpServer.headersTimeout = 66_000;
   httpServer.listen(
     {
       port,
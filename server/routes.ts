@@ -1,79 +1,212 @@
-import type { Express } from "express";
+import type { Express, Response } from "express";
 import { createServer, type Server } from "http";
-import { db } from "./firebase";
-import { WebSocketServer, WebSocket } from "ws";
+import { CatalogIndex } from "./catalog";
+import { createInventoryStorage, DEFAULT_SCANNER_MODE, type StoredItem } from "./storage";
+import { TransactionJournal, type JournalEntry } from "./transaction-journal";
+import { WebSocketServer } from "ws";
+import { WsFanout } from "./ws-fanout";
 import { scannerModeSchema, type ScannerMode } from "@shared/schema";
 
+const getStockHealth = (qty: number, origStock: number) => {
+  if (qty <= 0) return 'out_of_stock';
+  const percentage = origStock > 0 ? (qty / origStock) * 100 : 100;
+  return percentage >= 31 ? 'healthy' : 'low';
+};
+
+// Per-item mutation queue: stock changes to one barcode run strictly one
+// after another, while different barcodes proceed in parallel.
+const itemLocks = new Map<string, Promise<unknown>>();
+
+function withItemLock<T>(barcode: string, fn: () => Promise<T>): Promise<T> {
+  const previous = itemLocks.get(barcode) || Promise.resolve();
+  const run = previous.then(fn);
+  const tail = run.catch(() => undefined);
+  itemLocks.set(barcode, tail);
+  tail.then(() => {
+    if (itemLocks.get(barcode) === tail) {
+      itemLocks.delete(barcode);
+    }
+  });
+  return run;
+}
+
+// Scanners send an id with each scan and reuse it when they retry, so a
+// retry of a scan the server already applied (response lost to a timeout)
+// gets the original response instead of changing stock a second time.
+const SCAN_REPLAY_TTL_MS = 10 * 60 * 1000;
+const SCAN_REPLAY_MAX = 5000;
+
+type ScanResponse = { status: number; body: unknown };
+const recentScans = new Map<string, { expires: number; response: Promise<ScanResponse> }>();
+
+function rememberScanResponse(scanId: string, res: Response) {
+  // Entries are in insertion order, which is also expiry order, so eviction
+  // stops at the first live one. Walks the Map's own iterator rather than a
+  // copy of it; deleting the current entry does not disturb it.
+  const now = Date.now();
+  const entries = recentScans.entries();
+  for (let next = entries.next(); !next.done; next = entries.next()) {
+    const [id, entry] = next.value;
+    if (entry.expires > now && recentScans.size < SCAN_REPLAY_MAX) break;
+    recentScans.delete(id);
+  }
+
+  let resolve!: (response: ScanResponse) => void;
+  const response = new Promise<ScanResponse>((r) => { resolve = r; });
+  recentScans.set(scanId, { expires: now + SCAN_REPLAY_TTL_MS, response });
+
+  const originalJson = res.json;
+  res.json = function (body, ...args) {
+    // A failed scan changed nothing, so its retry should run for real
+    if (res.statusCode >= 500) {
+      recentScans.delete(scanId);
+    }
+    resolve({ status: res.statusCode, body });
+    return originalJson.apply(res, [body, ...args]);
+  };
+}
+
 export async function registerRoutes(
   httpServer: Server,
   app: Express
 ): Promise<Server> {
-  const itemsRef = db.ref('items');
-  const transactionsRef = db.ref('transactions');
-  const scannerModeRef = db.ref('scannerMode');
-
-  const wss = new WebSocketServer({ server: httpServer, path: '/ws' });
-  const clients = new Set<WebSocket>();
+  const store = await createInventoryStorage();
+  const catalog = new CatalogIndex();
+
+  // Authoritative in-memory copies maintained from the storage change feed,
+  // so the scan path never waits on a storage read. Writes made through the
+  // store are reported before they resolve, keeping the copies in step with
+  // our own updates.
+  const itemsIndex: Record<string, StoredItem> = {};
+  let itemsVersion = 0;
+  let scannerModeIndex: ScannerMode = DEFAULT_SCANNER_MODE;
+
+  // Scan responses don't wait on the transaction log: records go to a local
+  // append-only journal and reach storage in batched writes shortly after
+  const journal = new TransactionJournal(
+    process.env.TRANSACTION_JOURNAL_PATH || '.data/transaction-journal.jsonl',
+    (entries) => store.writeTransactions(entries),
+  );
+
+  const recordTransaction = (transaction: JournalEntry['transaction']) => {
+    journal.append({ key: store.newTransactionKey(), transaction });
+  };
 
-  wss.on('connection', (ws) => {
-    clients.add(ws);
-    console.log('WebSocket client connected');
+  // The scan only waits for the stock write. The store reports the change
+  // before this resolves, so the next queued mutation for the same item
+  // already reads the new quantity.
+  const commitStockChange = async (barcode: string, quantity: number, transaction: JournalEntry['transaction']) => {
+    await store.updateItem(barcode, { quantity });
+    recordTransaction(transaction);
+  };
 
-    ws.on('close', () => {
-      clients.delete(ws);
-      console.log('WebSocket client disconnected');
-    });
+  const wss = new WebSocketServer({ server: httpServer, path: '/ws' });
+  const fanout = new WsFanout();
+
+  const toItem = (barcode: string, item: StoredItem) => ({
+    id: barcode,
+    barcode,
+    name: item.name,
+    category: item.category,
+    quantity: item.quantity,
+    originalStock: item.originalStock || item.quantity,
+    createdAt: item.createdAt || new Date().toISOString(),
   });
 
-  const broadcast = (type: string, data: any) => {
-    const message = JSON.stringify({ type, data });
-    clients.forEach((client) => {
-      if (client.readyState === WebSocket.OPEN) {
-        client.send(message);
-      }
-    });
+  const listItems = () => {
+    const items = Object.entries(itemsIndex).map(([barcode, item]) => toItem(barcode, item));
+    items.sort((a, b) => new Date(b.createdAt).getTime() - new Date(a.createdAt).getTime());
+    return items;
   };
 
-  itemsRef.on('value', async (snapshot) => {
-    const data = snapshot.val() || {};
-    const items = Object.entries(data).map(([barcode, item]: [string, any]) => ({
-      id: barcode,
-      barcode,
-      name: item.name,
-      category: item.category,
-      quantity: item.quantity,
-      originalStock: item.originalStock || item.quantity,
-      createdAt: item.createdAt || new Date().toISOString(),
-    }));
-    items.sort((a, b) => new Date(b.createdAt).getTime() - new Date(a.createdAt).getTime());
-    broadcast('items_update', items);
+  const itemsSnapshotFrame = () => JSON.stringify({
+    type: 'items_snapshot',
+    data: { version: itemsVersion, items: listItems() },
   });
 
-  transactionsRef.on('child_added', async (snapshot) => {
-    const transaction = snapshot.val();
-    if (transaction) {
-      const itemSnapshot = await itemsRef.child(transaction.barcode).once('value');
-      const item = itemSnapshot.val();
-      const enrichedTransaction = {
-        id: snapshot.key,
+  // Existing items are delivered before itemsReady resolves; nobody needs
+  // those as deltas, so broadcasting starts afterwards.
+  let itemsLoaded = false;
+
+  const broadcastItemsDelta = (changed: any[], removed: string[]) => {
+    itemsVersion++;
+    if (itemsLoaded) {
+      // A client that is backed up gets one snapshot instead of a pile of deltas
+      fanout.broadcast('items_delta', { version: itemsVersion, changed, removed }, {
+        coalesce: 'items',
+        superseded: itemsSnapshotFrame,
+      });
+    }
+  };
+
+  const { itemsReady, scannerModeReady } = store.subscribe({
+    itemUpserted(barcode, item) {
+      itemsIndex[barcode] = item;
+      catalog.upsert(barcode, item);
+      broadcastItemsDelta([toItem(barcode, item)], []);
+    },
+    itemRemoved(barcode) {
+      delete itemsIndex[barcode];
+      catalog.remove(barcode);
+      broadcastItemsDelta([], [barcode]);
+    },
+    scannerModeChanged(mode) {
+      scannerModeIndex = mode;
+      fanout.broadcast('scanner_mode_update', mode, { coalesce: 'scanner_mode' });
+    },
+    transactionAdded(id, transaction) {
+      const item = itemsIndex[transaction.barcode];
+      fanout.broadcastTransaction({
+        id,
         ...transaction,
         itemName: item?.name || 'Unknown Item',
         category: item?.category || 'Unknown',
-      };
-      broadcast('transaction_added', enrichedTransaction);
-    }
+      });
+    },
   });
 
-  scannerModeRef.on('value', (snapshot) => {
-    const mode = snapshot.val() || { mode: 'DECREMENT', quantity: 1 };
-    broadcast('scanner_mode_update', mode);
+  itemsReady.then(() => {
+    itemsLoaded = true;
+  });
+
+  // Scanners trust a barcode-filter miss only while their filter matches
+  // the server's, so the responses on their kept-alive connection carry
+  // its version and a stale filter is noticed without a request of its own
+  const setBarcodeFilterHeaders = (res: Response) => {
+    if (itemsLoaded) {
+      res.set('X-Catalog-Epoch', String(catalog.epoch));
+      res.set('X-Barcode-Filter-Version', String(catalog.barcodeSetVersion));
+    }
+  };
+
+  wss.on('connection', (ws) => {
+    fanout.add(ws);
+    console.log('WebSocket client connected');
+
+    // Full item lists are only sent on request: on connect, or when a
+    // client notices a gap in the items_delta version sequence
+    ws.on('message', async (raw) => {
+      try {
+        const message = JSON.parse(raw.toString());
+        if (message.type === 'items_snapshot_request') {
+          await itemsReady;
+          fanout.send(ws, 'items_snapshot', { version: itemsVersion, items: listItems() }, { coalesce: 'items' });
+        }
+      } catch (error) {
+        console.error('Invalid WebSocket message:', error);
+      }
+    });
+
+    ws.on('close', () => {
+      fanout.remove(ws);
+      console.log('WebSocket client disconnected');
+    });
   });
 
   app.get("/api/scanner-mode", async (req, res) => {
     try {
-      const snapshot = await scannerModeRef.once('value');
-      const mode = snapshot.val() || { mode: 'DECREMENT', quantity: 1 };
-      res.json(mode);
+      await scannerModeReady;
+      res.json(scannerModeIndex);
     } catch (error) {
       console.error('Error fetching scanner mode:', error);
       res.status(500).json({ error: 'Failed to fetch scanner mode' });
@@ -88,7 +221,7 @@ export async function registerRoutes(
       }
 
       const modeData = result.data;
-      await scannerModeRef.set(modeData);
+      await store.setScannerMode(modeData);
       
       res.json(modeData);
     } catch (error) {
@@ -98,6 +231,7 @@ export async function registerRoutes(
   });
 
   app.get("/healthz", (req, res) => {
+    setBarcodeFilterHeaders(res);
     res.status(200).json({ status: "ok", timestamp: new Date().toISOString() });
   });
 
@@ -107,22 +241,8 @@ export async function registerRoutes(
 
   app.get("/api/items", async (req, res) => {
     try {
-      const snapshot = await itemsRef.once('value');
-      const data = snapshot.val() || {};
-      
-      const items = Object.entries(data).map(([barcode, item]: [string, any]) => ({
-        id: barcode,
-        barcode,
-        name: item.name,
-        category: item.category,
-        quantity: item.quantity,
-        originalStock: item.originalStock || item.quantity,
-        createdAt: item.createdAt || new Date().toISOString(),
-      }));
-      
-      items.sort((a, b) => new Date(b.createdAt).getTime() - new Date(a.createdAt).getTime());
-      
-      res.json(items);
+      await itemsReady;
+      res.json(listItems());
     } catch (error) {
       console.error('Error fetching items:', error);
       res.status(500).json({ error: 'Failed to fetch items' });
@@ -137,8 +257,8 @@ export async function registerRoutes(
         return res.status(400).json({ error: 'Missing required fields' });
       }
 
-      const existingSnapshot = await itemsRef.child(barcode).once('value');
-      if (existingSnapshot.exists()) {
+      await itemsReady;
+      if (itemsIndex[barcode]) {
         return res.status(400).json({ error: 'Item with this barcode already exists' });
       }
 
@@ -150,7 +270,7 @@ export async function registerRoutes(
         createdAt: new Date().toISOString(),
       };
 
-      await itemsRef.child(barcode).set(itemData);
+      await store.putItem(barcode, itemData);
       
       res.status(201).json({
         id: barcode,
@@ -166,7 +286,9 @@ export async function registerRoutes(
   app.delete("/api/items/:id", async (req, res) => {
     try {
       const { id } = req.params;
-      await itemsRef.child(id).remove();
+      // Queued behind any scan of this item; a scan queued after it finds
+      // the item gone instead of writing a nameless one back
+      await withItemLock(id, () => store.removeItem(id));
       res.json({ success: true });
     } catch (error) {
       console.error('Error deleting item:', error);
@@ -191,10 +313,9 @@ export async function registerRoutes(
         updateData.originalStock = Number(originalStock);
       }
 
-      await itemsRef.child(id).update(updateData);
+      await withItemLock(id, () => store.updateItem(id, updateData));
 
-      const snapshot = await itemsRef.child(id).once('value');
-      const item = snapshot.val();
+      const item = itemsIndex[id];
       
       res.json({
         id,
@@ -209,15 +330,25 @@ export async function registerRoutes(
 
   app.post("/api/scan", async (req, res) => {
     try {
-      const { barcode } = req.body;
+      const { barcode, scanId } = req.body;
 
       if (!barcode) {
         return res.status(400).json({ error: 'Barcode is required' });
       }
 
-      const snapshot = await itemsRef.child(barcode).once('value');
+      if (typeof scanId === 'string' && scanId) {
+        const previous = recentScans.get(scanId);
+        if (previous) {
+          const { status, body } = await previous.response;
+          return res.status(status).json(body);
+        }
+        rememberScanResponse(scanId, res);
+      }
+
+      await Promise.all([itemsReady, scannerModeReady]);
+      setBarcodeFilterHeaders(res);
 
-      if (!snapshot.exists()) {
+      if (!itemsIndex[barcode]) {
         return res.status(404).json({ 
           success: false,
           error: 'Item not found',
@@ -225,22 +356,12 @@ export async function registerRoutes(
         });
       }
 
-      const item = snapshot.val();
-      const currentQuantity = item.quantity || 0;
-
-      const modeSnapshot = await scannerModeRef.once('value');
-      const scannerMode: ScannerMode = modeSnapshot.val() || { mode: 'DECREMENT', quantity: 1 };
-      const { mode, quantity: modeQuantity } = scannerMode;
+      const { mode, quantity: modeQuantity } = scannerModeIndex;
 
       if (mode === 'DETAILS') {
+        const item = itemsIndex[barcode];
+        const currentQuantity = item.quantity || 0;
         const originalStock = item.originalStock || currentQuantity;
-        
-        const getStockHealth = (qty: number, origStock: number) => {
-          if (qty <= 0) return 'out_of_stock';
-          const percentage = origStock > 0 ? (qty / origStock) * 100 : 100;
-          return percentage >= 31 ? 'healthy' : 'low';
-        };
-        
         const stockHealth = getStockHealth(currentQuantity, originalStock);
         
         const transactionData = {
@@ -249,7 +370,7 @@ export async function registerRoutes(
           quantity: 0,
           timestamp: Date.now(),
         };
-        await transactionsRef.push(transactionData);
+        recordTransaction(transactionData);
 
         return res.json({
           success: true,
@@ -269,115 +390,119 @@ export async function registerRoutes(
       }
 
       if (mode === 'DECREMENT') {
-        const originalStock = item.originalStock || currentQuantity;
-        
-        const getStockHealth = (qty: number, origStock: number) => {
-          if (qty <= 0) return 'out_of_stock';
-          const percentage = origStock > 0 ? (qty / origStock) * 100 : 100;
-          return percentage >= 31 ? 'healthy' : 'low';
-        };
+        // Read-compute-write runs under the item's lock so concurrent scans
+        // of the same SKU see each other's results instead of losing updates
+        return await withItemLock(barcode, async () => {
+          const item = itemsIndex[barcode];
+          if (!item) {
+            return res.status(404).json({ 
+              success: false,
+              error: 'Item not found',
+              action: 'NOT_FOUND',
+            });
+          }
+
+          const currentQuantity = item.quantity || 0;
+          const originalStock = item.originalStock || currentQuantity;
+
+          if (currentQuantity <= 0) {
+            return res.json({
+              success: false,
+              item: {
+                id: barcode,
+                barcode,
+                ...item,
+              },
+              name: item.name,
+              category: item.category,
+              action: 'DEDUCT',
+              quantityChanged: 0,
+              requestedQuantity: modeQuantity,
+              message: 'Item is out of stock',
+              newStock: 0,
+              stockHealth: 'out_of_stock',
+            });
+          }
+
+          const deductAmount = Math.min(modeQuantity, currentQuantity);
+          const newQuantity = currentQuantity - deductAmount;
+          const wasPartialDeduction = deductAmount < modeQuantity;
+
+          await commitStockChange(barcode, newQuantity, {
+            barcode,
+            action: 'DEDUCT',
+            quantity: deductAmount,
+            timestamp: Date.now(),
+          });
+
+          const stockHealth = getStockHealth(newQuantity, originalStock);
+          
+          let message = `Stock decreased by ${deductAmount}`;
+          if (wasPartialDeduction) {
+            message = `Only ${deductAmount} deducted (was max available). Requested: ${modeQuantity}`;
+          }
 
-        if (currentQuantity <= 0) {
           return res.json({
-            success: false,
+            success: true,
             item: {
               id: barcode,
               barcode,
               ...item,
+              quantity: newQuantity,
             },
             name: item.name,
             category: item.category,
             action: 'DEDUCT',
-            quantityChanged: 0,
+            quantityChanged: deductAmount,
             requestedQuantity: modeQuantity,
-            message: 'Item is out of stock',
-            newStock: 0,
-            stockHealth: 'out_of_stock',
+            wasPartialDeduction,
+            newStock: newQuantity,
+            stockHealth,
+            message,
           });
-        }
-
-        const deductAmount = Math.min(modeQuantity, currentQuantity);
-        const newQuantity = currentQuantity - deductAmount;
-        const wasPartialDeduction = deductAmount < modeQuantity;
-        
-        await itemsRef.child(barcode).update({
-          quantity: newQuantity,
-        });
-
-        const transactionData = {
-          barcode,
-          action: 'DEDUCT',
-          quantity: deductAmount,
-          timestamp: Date.now(),
-        };
-        await transactionsRef.push(transactionData);
-
-        const stockHealth = getStockHealth(newQuantity, originalStock);
-        
-        let message = `Stock decreased by ${deductAmount}`;
-        if (wasPartialDeduction) {
-          message = `Only ${deductAmount} deducted (was max available). Requested: ${modeQuantity}`;
-        }
-
-        return res.json({
-          success: true,
-          item: {
-            id: barcode,
-            barcode,
-            ...item,
-            quantity: newQuantity,
-          },
-          name: item.name,
-          category: item.category,
-          action: 'DEDUCT',
-          quantityChanged: deductAmount,
-          requestedQuantity: modeQuantity,
-          wasPartialDeduction,
-          newStock: newQuantity,
-          stockHealth,
-          message,
         });
       }
 
       if (mode === 'INCREMENT') {
-        const originalStock = item.originalStock || currentQuantity;
-        const newQuantity = currentQuantity + modeQuantity;
-        
-        const getStockHealth = (qty: number, origStock: number) => {
-          if (qty <= 0) return 'out_of_stock';
-          const percentage = origStock > 0 ? (qty / origStock) * 100 : 100;
-          return percentage >= 31 ? 'healthy' : 'low';
-        };
-        
-        await itemsRef.child(barcode).update({
-          quantity: newQuantity,
-        });
-
-        const transactionData = {
-          barcode,
-          action: 'ADD',
-          quantity: modeQuantity,
-          timestamp: Date.now(),
-        };
-        await transactionsRef.push(transactionData);
+        return await withItemLock(barcode, async () => {
+          const item = itemsIndex[barcode];
+          if (!item) {
+            return res.status(404).json({ 
+              success: false,
+              error: 'Item not found',
+              action: 'NOT_FOUND',
+            });
+          }
+
+          const currentQuantity = item.quantity || 0;
+          const originalStock = item.originalStock || currentQuantity;
+          const newQuantity = currentQuantity + modeQuantity;
+
+          await commitStockChange(barcode, newQuantity, {
+            barcode,
+            action: 'ADD',
+            quantity: modeQuantity,
+            timestamp: Date.now(),
+          });
 
-        const stockHealth = getStockHealth(newQuantity, originalStock);
+          const stockHealth = getStockHealth(newQuantity, originalStock);
 
-        return res.json({
-          success: true,
-          item: {
-            id: barcode,
-            barcode,
-            ...item,
-            quantity: newQuantity,
-          },
-          name: item.name,
-          category: item.category,
-          action: 'ADD',
-          quantityChanged: modeQuantity,
-          newStock: newQuantity,
-          stockHealth,
-          message: `Stock increased by ${modeQuantity}`,
+          return res.json({
+            success: true,
+            item: {
+              id: barcode,
+              barcode,
+              ...item,
+              quantity: newQuantity,
+            },
+            name: item.name,
+            category: item.category,
+            action: 'ADD',
+            quantityChanged: modeQuantity,
+            newStock: newQuantity,
+            stockHealth,
+            message: `Stock increased by ${modeQuantity}`,
+          });
         });
       }
 
@@ -392,13 +517,13 @@ export async function registerRoutes(
     try {
       const { barcode } = req.params;
 
-      const snapshot = await itemsRef.child(barcode).once('value');
+      await itemsReady;
+      const item = itemsIndex[barcode];
 
-      if (!snapshot.exists()) {
+      if (!item) {
         return res.status(404).json({ error: 'Item not found' });
       }
 
-      const item = snapshot.val();
       const quantity = item.quantity || 0;
       const originalStock = item.originalStock || quantity;
       const percentage = originalStock > 0 ? (quantity / originalStock) * 100 : 0;
@@ -420,24 +545,80 @@ export async function registerRoutes(
     }
   });
 
+  // Devices erase their catalog partition before storing an image, so none
+  // is served until the initial item load has finished
+  app.get("/api/catalog", async (req, res) => {
+    try {
+      await itemsReady;
+      const image = catalog.buildImage();
+      res.set('Content-Type', 'application/octet-stream');
+      res.set('X-Catalog-Epoch', String(catalog.epoch));
+      res.set('X-Catalog-Version', String(catalog.version));
+      res.send(image);
+    } catch (error) {
+      console.error('Error building catalog image:', error);
+      res.status(500).json({ error: 'Failed to build catalog' });
+    }
+  });
+
+  app.get("/api/catalog/delta", async (req, res) => {
+    const epoch = Number(req.query.epoch);
+    const since = Number(req.query.since);
+
+    if (!Number.isInteger(epoch) || !Number.isInteger(since) || since < 0) {
+      return res.status(400).json({ error: 'epoch and since are required' });
+    }
+
+    try {
+      await itemsReady;
+      const delta = catalog.buildDelta(epoch, since);
+      if (!delta) {
+        return res.status(410).json({ error: 'Delta unavailable, fetch /api/catalog' });
+      }
+
+      res.set('Content-Type', 'application/octet-stream');
+      res.set('X-Catalog-Epoch', String(catalog.epoch));
+      res.set('X-Catalog-Version', String(catalog.version));
+      res.send(delta);
+    } catch (error) {
+      console.error('Error building catalog delta:', error);
+      res.status(500).json({ error: 'Failed to build catalog delta' });
+    }
+  });
+
+  // An empty filter would make devices reject every scan, so none is
+  // served until the initial item load has finished
+  app.get("/api/barcode-filter", async (req, res) => {
+    try {
+      await itemsReady;
+      if (Number(req.query.epoch) === catalog.epoch && Number(req.query.version) === catalog.barcodeSetVersion) {
+        return res.status(304).end();
+      }
+
+      res.set('Content-Type', 'application/octet-stream');
+      res.set('X-Catalog-Epoch', String(catalog.epoch));
+      res.set('X-Barcode-Filter-Version', String(catalog.barcodeSetVersion));
+      res.send(catalog.buildBarcodeFilter());
+    } catch (error) {
+      console.error('Error building barcode filter:', error);
+      res.status(500).json({ error: 'Failed to build barcode filter' });
+    }
+  });
+
   app.get("/api/transactions", async (req, res) => {
     try {
-      const snapshot = await transactionsRef.orderByChild('timestamp').limitToLast(100).once('value');
-      const data = snapshot.val() || {};
-      const itemsSnapshot = await itemsRef.once('value');
-      const itemsData = itemsSnapshot.val() || {};
-      
-      const transactions = await Promise.all(
-        Object.entries(data).map(async ([id, transaction]: [string, any]) => {
-          const item = itemsData[transaction.barcode];
-          return {
-            id,
-            ...transaction,
-            itemName: item?.name || 'Unknown Item',
-            category: item?.category || 'Unknown',
-          };
-        })
-      );
+      const collected = await store.recentTransactions(100);
+
+      await itemsReady;
+      const transactions = collected.map(([id, transaction]) => {
+        const item = itemsIndex[transaction.barcode];
+        return {
+          id,
+          ...transaction,
+          itemName: item?.name || 'Unknown Item',
+          category: item?.category || 'Unknown',
+        };
+      });
       
       transactions.sort((a, b) => b.timestamp - a.timestamp);
       
@@ -448,5 +629,30 @@ export async function registerRoutes(
     }
   });
 
+  app.get("/api/rollups/days", async (req, res) => {
+    try {
+      const limit = Math.min(Number(req.query.limit) || 30, 366);
+      const days = await store.dayRollups(limit);
+      res.json(days);
+    } catch (error) {
+      console.error('Error fetching day rollups:', error);
+      res.status(500).json({ error: 'Failed to fetch day rollups' });
+    }
+  });
+
+  app.get("/api/rollups/items", async (req, res) => {
+    try {
+      const rollups = await store.itemRollups();
+      const items = rollups.map((rollup) => ({
+        ...rollup,
+        itemName: itemsIndex[rollup.barcode]?.name || 'Unknown Item',
+      }));
+      res.json(items);
+    } catch (error) {
+      console.error('Error fetching item rollups:', error);
+      res.status(500).json({ error: 'Failed to fetch item rollups' });
+    }
+  });
+
   return httpServer;
 }
@@ -1,5 +1,8 @@
-import { type User, type InsertUser } from "@shared/schema";
+import { type User, type InsertUser, type ScannerMode } from "@shared/schema";
 import { randomUUID } from "crypto";
+import { appendFileSync, existsSync, mkdirSync, readFileSync, renameSync, writeFileSync } from "fs";
+import { dirname } from "path";
+import type { JournalEntry } from "./transaction-journal";
 
 // modify the interface with any CRUD methods
 // you might need
@@ -36,3 +39,240 @@ export class MemStorage implements IStorage {
 }
 
 export const storage = new MemStorage();
+
+// ================= Inventory storage =================
+
+export interface StoredItem {
+  name: string;
+  category: string;
+  quantity: number;
+  originalStock?: number;
+  createdAt?: string;
+}
+
+export type StoredTransaction = JournalEntry['transaction'];
+
+export interface DayRollup {
+  day: string;
+  added: number;
+  deducted: number;
+  views: number;
+  count: number;
+}
+
+export interface ItemRollup {
+  barcode: string;
+  added: number;
+  deducted: number;
+  views: number;
+  lastScanAt: number | null;
+}
+
+// Change feed a backend pushes into the route layer. Writes made through
+// the backend itself are reported here too, before the write resolves.
+export interface InventoryListener {
+  itemUpserted(barcode: string, item: StoredItem): void;
+  itemRemoved(barcode: string): void;
+  scannerModeChanged(mode: ScannerMode): void;
+  transactionAdded(id: string, transaction: StoredTransaction): void;
+}
+
+export interface IInventoryStorage {
+  // Starts the change feed. Existing items and the current scanner mode are
+  // delivered first; the returned promises resolve once they have been.
+  subscribe(listener: InventoryListener): { itemsReady: Promise<void>; scannerModeReady: Promise<void> };
+
+  putItem(barcode: string, item: StoredItem): Promise<void>;
+  updateItem(barcode: string, fields: Partial<StoredItem>): Promise<void>;
+  removeItem(barcode: string): Promise<void>;
+  setScannerMode(mode: ScannerMode): Promise<void>;
+
+  newTransactionKey(): string;
+  // Must tolerate a batch being written twice (journal replay, or a retry
+  // of a write that landed): records and rollups count each key once
+  writeTransactions(entries: JournalEntry[]): Promise<void>;
+  recentTransactions(limit: number): Promise<[string, StoredTransaction][]>;
+  dayRollups(limit: number): Promise<DayRollup[]>;
+  itemRollups(): Promise<ItemRollup[]>;
+}
+
+export const DEFAULT_SCANNER_MODE: ScannerMode = { mode: 'DECREMENT', quantity: 1 };
+
+// Transactions are bucketed per UTC day
+export const dayBucket = (timestamp: number) => new Date(timestamp).toISOString().slice(0, 10);
+
+export const rollupCounter = (action: string) =>
+  action === 'ADD' ? 'added' : action === 'DEDUCT' ? 'deducted' : 'views';
+
+type LogRecord =
+  | { t: 'item'; barcode: string; item: StoredItem | null }
+  | { t: 'mode'; mode: ScannerMode }
+  | { t: 'tx'; key: string; transaction: StoredTransaction };
+
+// Embedded backend for on-premise installs and benchmarks: one append-only
+// JSON-lines log replayed into memory at startup. Every read is served from
+// memory and every write is a single synchronous append, so the scan path
+// never leaves the machine. The log is compacted on open, dropping
+// superseded item and mode records.
+export class LocalInventoryStorage implements IInventoryStorage {
+  private items = new Map<string, StoredItem>();
+  private scannerMode: ScannerMode = DEFAULT_SCANNER_MODE;
+  private transactions: { key: string; transaction: StoredTransaction }[] = [];
+  private transactionKeys = new Set<string>();
+  private days = new Map<string, DayRollup>();
+  private itemTotals = new Map<string, ItemRollup>();
+  private listener: InventoryListener | null = null;
+
+  constructor(private readonly path: string) {
+    mkdirSync(dirname(path), { recursive: true });
+
+    let records = 0;
+    if (existsSync(path)) {
+      for (const line of readFileSync(path, 'utf8').split('\n')) {
+        if (!line.trim()) continue;
+        try {
+          this.apply(JSON.parse(line));
+          records++;
+        } catch {
+          console.error('Local storage: skipping corrupt line');
+        }
+      }
+    }
+
+    const live = this.items.size + 1 + this.transactions.length;
+    if (records > live) {
+      this.compact();
+    }
+    console.log(`Local storage: ${this.items.size} items, ${this.transactions.length} transactions from ${path}`);
+  }
+
+  subscribe(listener: InventoryListener) {
+    this.listener = listener;
+    this.items.forEach((item, barcode) => listener.itemUpserted(barcode, item));
+    listener.scannerModeChanged(this.scannerMode);
+    return { itemsReady: Promise.resolve(), scannerModeReady: Promise.resolve() };
+  }
+
+  async putItem(barcode: string, item: StoredItem) {
+    this.write({ t: 'item', barcode, item });
+  }
+
+  async updateItem(barcode: string, fields: Partial<StoredItem>) {
+    const existing = this.items.get(barcode);
+    this.write({ t: 'item', barcode, item: { ...existing, ...fields } as StoredItem });
+  }
+
+  async removeItem(barcode: string) {
+    if (this.items.has(barcode)) {
+      this.write({ t: 'item', barcode, item: null });
+    }
+  }
+
+  async setScannerMode(mode: ScannerMode) {
+    this.write({ t: 'mode', mode });
+  }
+
+  newTransactionKey() {
+    return randomUUID();
+  }
+
+  async writeTransactions(entries: JournalEntry[]) {
+    const fresh = entries.filter(({ key }) => !this.transactionKeys.has(key));
+    if (fresh.length === 0) return;
+
+    appendFileSync(this.path, fresh.map(({ key, transaction }) =>
+      JSON.stringify({ t: 'tx', key, transaction }) + '\n').join(''));
+    for (const { key, transaction } of fresh) {
+      this.apply({ t: 'tx', key, transaction });
+      this.listener?.transactionAdded(key, transaction);
+    }
+  }
+
+  async recentTransactions(limit: number): Promise<[string, StoredTransaction][]> {
+    return this.transactions
+      .slice(-limit)
+      .reverse()
+      .map(({ key, transaction }): [string, StoredTransaction] => [key, transaction]);
+  }
+
+  async dayRollups(limit: number) {
+    return Array.from(this.days.values())
+      .sort((a, b) => (a.day < b.day ? -1 : a.day > b.day ? 1 : 0))
+      .slice(-limit)
+      .map((rollup) => ({ ...rollup }));
+  }
+
+  async itemRollups() {
+    return Array.from(this.itemTotals.values()).map((rollup) => ({ ...rollup }));
+  }
+
+  private write(record: LogRecord) {
+    appendFileSync(this.path, JSON.stringify(record) + '\n');
+    this.apply(record);
+
+    if (record.t === 'item') {
+      if (record.item) {
+        this.listener?.itemUpserted(record.barcode, record.item);
+      } else {
+        this.listener?.itemRemoved(record.barcode);
+      }
+    } else if (record.t === 'mode') {
+      this.listener?.scannerModeChanged(record.mode);
+    }
+  }
+
+  private apply(record: LogRecord) {
+    if (record.t === 'item') {
+      if (record.item) {
+        this.items.set(record.barcode, record.item);
+      } else {
+        this.items.delete(record.barcode);
+      }
+    } else if (record.t === 'mode') {
+      this.scannerMode = record.mode;
+    } else if (record.t === 'tx' && !this.transactionKeys.has(record.key)) {
+      const { transaction } = record;
+      const day = dayBucket(transaction.timestamp);
+      const counter = rollupCounter(transaction.action);
+      const amount = transaction.action === 'VIEW' ? 1 : transaction.quantity;
+
+      this.transactions.push({ key: record.key, transaction });
+      this.transactionKeys.add(record.key);
+
+      const dayRollup = this.days.get(day) || { day, added: 0, deducted: 0, views: 0, count: 0 };
+      dayRollup[counter] += amount;
+      dayRollup.count++;
+      this.days.set(day, dayRollup);
+
+      const itemRollup = this.itemTotals.get(transaction.barcode) ||
+        { barcode: transaction.barcode, added: 0, deducted: 0, views: 0, lastScanAt: null };
+      itemRollup[counter] += amount;
+      itemRollup.lastScanAt = Math.max(itemRollup.lastScanAt || 0, transaction.timestamp);
+      this.itemTotals.set(transaction.barcode, itemRollup);
+    }
+  }
+
+  private compact() {
+    const lines: string[] = [];
+    this.items.forEach((item, barcode) => lines.push(JSON.stringify({ t: 'item', barcode, item })));
+    lines.push(JSON.stringify({ t: 'mode', mode: this.scannerMode }));
+    for (const { key, transaction } of this.transactions) {
+      lines.push(JSON.stringify({ t: 'tx', key, transaction }));
+    }
+
+    const tmpPath = `${this.path}.tmp`;
+    writeFileSync(tmpPath, lines.map((line) => line + '\n').join(''));
+    renameSync(tmpPath, this.path);
+  }
+}
+
+// STORAGE_BACKEND=local selects the embedded store; anything else uses
+// Firebase. The Firebase module is loaded lazily so the local backend runs
+// without credentials.
+export async function createInventoryStorage(): Promise<IInventoryStorage> {
+  if (process.env.STORAGE_BACKEND === 'local') {
+    return new LocalInventoryStorage(process.env.LOCAL_STORAGE_PATH || '.data/inventory.jsonl');
+  }
+  const { FirebaseInventoryStorage } = await import("./firebase-storage");
+  return new FirebaseInventoryStorage();
+}
@@ -0,0 +1,107 @@
+import { appendFileSync, existsSync, mkdirSync, readFileSync, renameSync, writeFileSync } from "fs";
+import { dirname } from "path";
+
+export interface JournalEntry {
+  key: string;
+  transaction: {
+    barcode: string;
+    action: string;
+    quantity: number;
+    timestamp: number;
+  };
+}
+
+interface JournalOptions {
+  flushIntervalMs?: number;
+  maxBatch?: number;
+}
+
+// Write-behind queue for transaction records. Entries are appended to a
+// local JSON-lines file before append() returns, then flushed to the
+// database in batches; the file is rewritten to hold only what is still
+// pending. Entries left in the file by a crash are replayed on startup.
+//
+// Delivery is at-least-once: a crash between a successful flush and the
+// file rewrite replays that batch. Entries are keyed, and storage backends
+// skip keys they already hold, so records and rollups still count once.
+export class TransactionJournal {
+  private pending: JournalEntry[] = [];
+  private timer: ReturnType<typeof setTimeout> | null = null;
+  private flushing = false;
+  private failures = 0;
+  private readonly flushIntervalMs: number;
+  private readonly maxBatch: number;
+
+  constructor(
+    private readonly path: string,
+    private readonly flushBatch: (entries: JournalEntry[]) => Promise<void>,
+    options: JournalOptions = {},
+  ) {
+    this.flushIntervalMs = options.flushIntervalMs ?? 200;
+    this.maxBatch = options.maxBatch ?? 500;
+
+    mkdirSync(dirname(path), { recursive: true });
+    if (existsSync(path)) {
+      for (const line of readFileSync(path, "utf8").split("\n")) {
+        if (!line.trim()) continue;
+        try {
+          this.pending.push(JSON.parse(line));
+        } catch {
+          console.error("Transaction journal: skipping corrupt line");
+        }
+      }
+    }
+    if (this.pending.length > 0) {
+      console.log(`Transaction journal: replaying ${this.pending.length} unflushed entries`);
+      this.schedule(0);
+    }
+  }
+
+  append(entry: JournalEntry) {
+    appendFileSync(this.path, JSON.stringify(entry) + "\n");
+    this.pending.push(entry);
+    this.schedule(this.flushIntervalMs);
+  }
+
+  get size() {
+    return this.pending.length;
+  }
+
+  private schedule(delayMs: number) {
+    if (this.timer || this.flushing) return;
+    this.timer = setTimeout(() => {
+      this.timer = null;
+      void this.flush();
+    }, delayMs);
+  }
+
+  private async flush() {
+    if (this.pending.length === 0) return;
+    this.flushing = true;
+
+    const batch = this.pending.slice(0, this.maxBatch);
+    try {
+      await this.flushBatch(batch);
+      this.pending.splice(0, batch.length);
+      this.failures = 0;
+      this.rewrite();
+    } catch (error) {
+      this.failures++;
+      console.error(`Transaction journal: flush of ${batch.length} entries failed:`, error);
+    } finally {
+      this.flushing = false;
+    }
+
+    if (this.pending.length > 0) {
+      // Back off while the database is unreachable, capped at 30s
+      const delay = this.failures > 0 ? Math.min(30000, 500 * 2 ** (this.failures - 1)) : 0;
+      this.schedule(delay);
+    }
+  }
+
+  private rewrite() {
+    const tmpPath = `${this.path}.tmp`;
+    writeFileSync(tmpPath, this.pending.map((entry) => JSON.stringify(entry) + "\n").join(""));
+    renameSync(tmpPath, this.path);
+  }
+}
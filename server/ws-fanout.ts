@@ -0,0 +1,133 @@
+import { WebSocket } from "ws";
+
+// Stop handing frames to the socket once this much is already buffered
+const HIGH_WATER_BYTES = 256 * 1024;
+// A client whose own queue grows past this is not keeping up at all
+const MAX_QUEUED_BYTES = 4 * 1024 * 1024;
+const DRAIN_RETRY_MS = 50;
+
+type Frame = string | (() => string);
+
+interface QueuedFrame {
+  key?: string;
+  frame: Frame;
+  bytes: number;
+}
+
+interface ClientQueue {
+  ws: WebSocket;
+  queue: QueuedFrame[];
+  queuedBytes: number;
+  retry: ReturnType<typeof setTimeout> | null;
+}
+
+export interface SendOptions {
+  // A newer frame with the same key replaces one still waiting in the queue
+  coalesce?: string;
+  // Built at send time instead of the new frame when a queued frame with the
+  // same key is replaced, e.g. a full snapshot standing in for several deltas
+  superseded?: () => string;
+}
+
+// WebSocket fan-out with a send queue per client. Frames go straight to the
+// socket while its bufferedAmount is under the high-water mark; past that
+// they wait in the client's queue, where superseded frames are coalesced.
+// Clients that fall hopelessly behind are dropped rather than buffered
+// without bound.
+export class WsFanout {
+  private clients = new Map<WebSocket, ClientQueue>();
+  private pendingTransactions: unknown[] = [];
+
+  add(ws: WebSocket) {
+    this.clients.set(ws, { ws, queue: [], queuedBytes: 0, retry: null });
+  }
+
+  remove(ws: WebSocket) {
+    const client = this.clients.get(ws);
+    if (client?.retry) {
+      clearTimeout(client.retry);
+    }
+    this.clients.delete(ws);
+  }
+
+  get size() {
+    return this.clients.size;
+  }
+
+  send(ws: WebSocket, type: string, data: unknown, options: SendOptions = {}) {
+    const client = this.clients.get(ws);
+    if (client) {
+      this.enqueue(client, JSON.stringify({ type, data }), options);
+    }
+  }
+
+  broadcast(type: string, data: unknown, options: SendOptions = {}) {
+    if (this.clients.size === 0) return;
+    const frame = JSON.stringify({ type, data });
+    this.clients.forEach((client) => this.enqueue(client, frame, options));
+  }
+
+  // Transactions recorded in the same tick go out as one transactions_added
+  // frame carrying an array
+  broadcastTransaction(transaction: unknown) {
+    this.pendingTransactions.push(transaction);
+    if (this.pendingTransactions.length === 1) {
+      setImmediate(() => {
+        const batch = this.pendingTransactions;
+        this.pendingTransactions = [];
+        this.broadcast('transactions_added', batch);
+      });
+    }
+  }
+
+  private enqueue(client: ClientQueue, frame: string, options: SendOptions) {
+    if (client.ws.readyState !== WebSocket.OPEN) return;
+
+    if (options.coalesce) {
+      const index = client.queue.findIndex((queued) => queued.key === options.coalesce);
+      if (index !== -1) {
+        const [replaced] = client.queue.splice(index, 1);
+        client.queuedBytes -= replaced.bytes;
+        if (options.superseded) {
+          // Size unknown until built; count the frame it replaces
+          this.push(client, { key: options.coalesce, frame: options.superseded, bytes: replaced.bytes });
+          return;
+        }
+      }
+    }
+
+    this.push(client, { key: options.coalesce, frame, bytes: frame.length });
+  }
+
+  private push(client: ClientQueue, queued: QueuedFrame) {
+    client.queue.push(queued);
+    client.queuedBytes += queued.bytes;
+
+    if (client.queuedBytes > MAX_QUEUED_BYTES) {
+      console.warn(`WebSocket client dropped: ${client.queuedBytes} bytes queued`);
+      this.remove(client.ws);
+      client.ws.terminate();
+      return;
+    }
+
+    this.drain(client);
+  }
+
+  private drain(client: ClientQueue) {
+    if (client.ws.readyState !== WebSocket.OPEN) return;
+
+    while (client.queue.length > 0 && client.ws.bufferedAmount < HIGH_WATER_BYTES) {
+      const queued = client.queue.shift() as QueuedFrame;
+      client.queuedBytes -= queued.bytes;
+      client.ws.send(typeof queued.frame === 'function' ? queued.frame() : queued.frame);
+    }
+
+    // ws has no event for bufferedAmount falling, so poll while backed up
+    if (client.queue.length > 0 && !client.retry) {
+      client.retry = setTimeout(() => {
+        client.retry = null;
+        this.drain(client);
+      }, DRAIN_RETRY_MS);
+    }
+  }
+}